@@ -0,0 +1,141 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+
+// -----------------------------------------------------------------------------
+// Page-backing policy for large arrays
+// -----------------------------------------------------------------------------
+
+static const std::size_t CACHE_LINE_SIZE = 64;
+static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+// arrays of at least this many bytes ask for 2 MB pages
+static const std::size_t HUGE_PAGE_THRESHOLD = HUGE_PAGE_SIZE;
+
+// which pages back an array
+enum PageBacking {
+    PAGES_SMALL,     // below threshold: regular 4 KB pages
+    PAGES_THP_REQUESTED,  // huge pages requested with madvise; the kernel
+                          // may still back some or all of it with 4 KB pages
+    PAGES_FALLBACK   // above threshold, but huge pages were unavailable
+};
+
+inline const char* pageBackingName(PageBacking b) {
+    switch (b) {
+        case PAGES_THP_REQUESTED: return "THP requested (2MB)";
+        case PAGES_FALLBACK: return "4KB (huge pages unavailable)";
+        default: return "4KB";
+    }
+}
+
+// true unless the kernel has transparent huge pages switched off
+inline bool hugePagesEnabled() {
+    static const bool enabled = []() {
+        std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+        std::string mode;
+        if (!std::getline(in, mode)) return false;
+        return mode.find("[never]") == std::string::npos;
+    }();
+    return enabled;
+}
+
+// bytes allocPages really allocates for a request of bytes
+inline std::size_t allocatedBytes(std::size_t bytes) {
+    if (bytes >= HUGE_PAGE_THRESHOLD) return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    return bytes;
+}
+
+// Allocate bytes aligned to a cache line. Blocks of HUGE_PAGE_THRESHOLD or
+// more are aligned and padded to 2 MB and advised as huge pages. What was
+// requested is written to *backing when non-null; whether the kernel
+// actually used huge pages is not checked. Release with free().
+inline void* allocPages(std::size_t bytes, PageBacking* backing = nullptr) {
+    void* p = nullptr;
+    PageBacking got = PAGES_SMALL;
+    if (bytes >= HUGE_PAGE_THRESHOLD) {
+        std::size_t rounded = allocatedBytes(bytes);
+        if (posix_memalign(&p, HUGE_PAGE_SIZE, rounded) != 0) throw std::bad_alloc();
+        got = PAGES_FALLBACK;
+#ifdef MADV_HUGEPAGE
+        if (hugePagesEnabled() && madvise(p, rounded, MADV_HUGEPAGE) == 0) got = PAGES_THP_REQUESTED;
+#endif
+    } else if (posix_memalign(&p, CACHE_LINE_SIZE, bytes ? bytes : 1) != 0) {
+        throw std::bad_alloc();
+    }
+    if (backing) *backing = got;
+    return p;
+}
+
+// std allocator using allocPages; records the backing of its most recent
+// allocation in the PageBacking it was constructed with
+template<typename T>
+struct HugePageAllocator {
+    typedef T value_type;
+    PageBacking* backing_;
+
+    HugePageAllocator(PageBacking* backing = nullptr) : backing_(backing) {}
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U>& other) : backing_(other.backing_) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(allocPages(n * sizeof(T), backing_));
+    }
+    void deallocate(T* p, std::size_t) { std::free(p); }
+};
+
+// every instance frees with free(), so all are interchangeable
+template<typename T, typename U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return false; }
+
+// -----------------------------------------------------------------------------
+// Memory accounting
+// -----------------------------------------------------------------------------
+
+// bytes held by a container, split by what they are spent on
+struct MemoryUsage {
+    std::size_t slotBytes;       // slot / bucket arrays
+    std::size_t nodeBytes;       // per-element nodes of live entries
+    std::size_t heapBytes;       // heap buffers owned by live keys and values
+    std::size_t tombstoneBytes;  // nodes and buffers still held by deleted entries
+    std::size_t filterBytes;     // approximate-membership filters
+    MemoryUsage() : slotBytes(0), nodeBytes(0), heapBytes(0), tombstoneBytes(0), filterBytes(0) {}
+    std::size_t total() const {
+        return slotBytes + nodeBytes + heapBytes + tombstoneBytes + filterBytes;
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& out, const MemoryUsage& mu) {
+    return out << mu.total() << " bytes (slots " << mu.slotBytes
+               << ", nodes " << mu.nodeBytes << ", heap " << mu.heapBytes
+               << ", tombstones " << mu.tombstoneBytes
+               << ", filters " << mu.filterBytes << ")";
+}
+
+// heap bytes owned by a value beyond sizeof(T)
+template<typename T>
+std::size_t heapBytes(const T&) { return 0; }
+
+// strings short enough for the in-object buffer own no heap memory
+inline std::size_t heapBytes(const std::string& s) {
+    const char* obj = reinterpret_cast<const char*>(&s);
+    bool inline_ = s.data() >= obj && s.data() < obj + sizeof(s);
+    return inline_ ? 0 : s.capacity() + 1;
+}
+
+template<typename T>
+std::size_t heapBytes(const std::vector<T>& v) {
+    std::size_t bytes = v.capacity() * sizeof(T);
+    for (const T& t : v) bytes += heapBytes(t);
+    return bytes;
+}
+
+#endif // ALLOC_H
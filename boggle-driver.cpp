@@ -3,33 +3,399 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
 #include <random>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 #include "boggle.h"
 
 using namespace std;
 
+// the dictionary structures chosen on the command line, loaded once
+struct Solver
+{
+	set<string> dictionary;
+	set<string> prefix;
+	XorFilter<> filter;
+	unique_ptr<DictTrie> trie;
+	bool useFilter;
+
+	set<string> solve(const vector<vector<char> >& board) const
+	{
+		if(trie) return boggle(*trie, board);
+		return useFilter ? boggle(dictionary, prefix, filter, board) : boggle(dictionary, prefix, board);
+	}
+};
+
+// load a word list and build the structures the options ask for
+shared_ptr<Solver> loadSolver(const string& fname, bool useFilter, bool useTrie)
+{
+	shared_ptr<Solver> solver(new Solver);
+	pair<set<string>, set<string> > parsed = parseDict(fname);
+	solver->dictionary.swap(parsed.first);
+	solver->prefix.swap(parsed.second);
+	solver->useFilter = useFilter;
+	if(useFilter) solver->filter = buildDictFilter(solver->dictionary, solver->prefix);
+	if(useTrie) solver->trie.reset(new DictTrie(solver->dictionary));
+	return solver;
+}
+
+string joinWords(const set<string>& found)
+{
+	stringstream os;
+	for(set<string>::const_iterator it=found.begin();it != found.end(); ++it)
+	{
+		os << *it << ", ";
+	}
+	return os.str().substr(0,os.str().size()-2);
+}
+
+bool writeAll(int fd, const char* data, size_t len)
+{
+	while(len > 0)
+	{
+		ssize_t n = write(fd, data, len);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false;
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+// Solve boards seed .. seed+boards-1 in forked worker processes. The
+// workers share the parent's dictionary through copy-on-write pages and
+// claim boards from a counter in a shared anonymous mapping. Each sends
+// "index, length, text" records up its own pipe; the parent prints the
+// results in seed order as they become available.
+int runBatch(const Solver& solver, int size, int seed, int boards, int workers)
+{
+	unsigned int* next = static_cast<unsigned int*>(mmap(nullptr, sizeof(unsigned int),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+	if(next == MAP_FAILED)
+	{
+		cerr << "mmap: " << strerror(errno) << endl;
+		return 1;
+	}
+	*next = 0;
+	vector<pid_t> pids;
+	vector<int> pipes;
+	bool error = false;
+	for(int w=0;w<workers;w++)
+	{
+		int fds[2];
+		if(pipe(fds) != 0)
+		{
+			cerr << "pipe: " << strerror(errno) << endl;
+			error = true;
+			break;
+		}
+		cout.flush();
+		pid_t pid = fork();
+		if(pid < 0)
+		{
+			cerr << "fork: " << strerror(errno) << endl;
+			close(fds[0]);
+			close(fds[1]);
+			error = true;
+			break;
+		}
+		if(pid == 0)
+		{
+			close(fds[0]);
+			for(size_t i=0;i<pipes.size();i++) close(pipes[i]);
+			unsigned int b;
+			while((b = __atomic_fetch_add(next, 1, __ATOMIC_RELAXED)) < unsigned(boards))
+			{
+				set<string> found = solver.solve(genBoard(size, seed + b));
+				stringstream os;
+				os << "seed " << seed + b << ": found " << found.size() << " words: " << joinWords(found);
+				string text = os.str();
+				uint32_t header[2] = {b, uint32_t(text.size())};
+				if(!writeAll(fds[1], reinterpret_cast<const char*>(header), sizeof(header)) ||
+				   !writeAll(fds[1], text.data(), text.size()))
+				{
+					_exit(1);
+				}
+			}
+			_exit(0);
+		}
+		close(fds[1]);
+		pids.push_back(pid);
+		pipes.push_back(fds[0]);
+	}
+
+	// reassemble each pipe's byte stream into records, print in order
+	vector<string> pending(pipes.size());
+	map<unsigned int, string> ready;
+	unsigned int printed = 0;
+	size_t open = pipes.size();
+	vector<pollfd> pfds(pipes.size());
+	for(size_t w=0;w<pipes.size();w++)
+	{
+		pfds[w].fd = pipes[w];
+		pfds[w].events = POLLIN;
+	}
+	char buf[1 << 16];
+	while(!error && open > 0)
+	{
+		if(poll(&pfds[0], pfds.size(), -1) < 0)
+		{
+			if(errno == EINTR) continue;
+			cerr << "poll: " << strerror(errno) << endl;
+			error = true;
+			break;
+		}
+		for(size_t w=0;w<pfds.size();w++)
+		{
+			if(pfds[w].fd < 0 || !(pfds[w].revents & (POLLIN | POLLHUP))) continue;
+			ssize_t n = read(pfds[w].fd, buf, sizeof(buf));
+			if(n < 0 && errno == EINTR) continue;
+			if(n <= 0)
+			{
+				close(pfds[w].fd);
+				pfds[w].fd = -1;
+				open--;
+				continue;
+			}
+			pending[w].append(buf, n);
+			uint32_t header[2];
+			while(pending[w].size() >= sizeof(header))
+			{
+				memcpy(header, pending[w].data(), sizeof(header));
+				if(pending[w].size() < sizeof(header) + header[1]) break;
+				ready[header[0]] = pending[w].substr(sizeof(header), header[1]);
+				pending[w].erase(0, sizeof(header) + header[1]);
+			}
+			while(!ready.empty() && ready.begin()->first == printed)
+			{
+				cout << ready.begin()->second << endl;
+				ready.erase(ready.begin());
+				printed++;
+			}
+		}
+	}
+	// every exit comes through here; after an error the workers are
+	// killed rather than drained
+	for(size_t w=0;w<pfds.size();w++)
+	{
+		if(pfds[w].fd >= 0) close(pfds[w].fd);
+	}
+	int failed = 0;
+	for(size_t i=0;i<pids.size();i++)
+	{
+		if(error) kill(pids[i], SIGKILL);
+		int status = 0;
+		while(waitpid(pids[i], &status, 0) < 0 && errno == EINTR);
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+	}
+	munmap(next, sizeof(unsigned int));
+	if(error) return 1;
+	if(failed || printed != unsigned(boards))
+	{
+		cerr << failed << " worker(s) failed; " << printed << " of " << boards << " boards reported" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+// parse all of text as a base-10 integer in [lo, hi]
+bool parseInt(const string& text, long lo, long hi, int& out)
+{
+	char* end;
+	errno = 0;
+	long v = strtol(text.c_str(), &end, 10);
+	if(end == text.c_str() || *end != '\0' || errno == ERANGE || v < lo || v > hi) return false;
+	out = int(v);
+	return true;
+}
+
+// larger boards are far beyond any dictionary word and only cost memory
+const int MAX_SERVE_SIZE = 64;
+
+// Resident solver: each stdin line "<seed>" or "<size> <seed>" is
+// answered with that board's words, "reload <file>" swaps in a new
+// dictionary and "quit" stops. Malformed lines, sizes outside
+// 1..MAX_SERVE_SIZE and failed solves get an error line and serving goes
+// on. A reload is built on a background thread while requests keep being
+// served, then published with atomic_exchange.
+// A request pins the dictionary it started with, so it finishes against
+// that one; the loader frees the old dictionary once no request holds it,
+// keeping the teardown off the request path.
+int serve(shared_ptr<const Solver> initial, int size, bool useFilter, bool useTrie)
+{
+	shared_ptr<const Solver> current = initial;
+	initial.reset();
+	mutex outLock;
+	atomic<bool> loading(false);
+	thread loader;
+	string line;
+	while(getline(cin, line))
+	{
+		istringstream in(line);
+		string cmd;
+		if(!(in >> cmd)) continue;
+		if(cmd == "quit") break;
+		if(cmd == "reload")
+		{
+			string fname;
+			in >> fname;
+			if(loading)
+			{
+				lock_guard<mutex> guard(outLock);
+				cout << "reload already in progress" << endl;
+				continue;
+			}
+			if(loader.joinable()) loader.join();
+			loading = true;
+			loader = thread([&current, &outLock, &loading, fname, useFilter, useTrie]() {
+				try
+				{
+					shared_ptr<const Solver> fresh = loadSolver(fname, useFilter, useTrie);
+					size_t words = fresh->dictionary.size();
+					shared_ptr<const Solver> old = atomic_exchange(&current, fresh);
+					fresh.reset();
+					{
+						lock_guard<mutex> guard(outLock);
+						cout << "reloaded " << fname << ": " << words << " words" << endl;
+					}
+					while(old.use_count() > 1) this_thread::sleep_for(chrono::milliseconds(1));
+				}
+				catch(const exception& e)
+				{
+					lock_guard<mutex> guard(outLock);
+					cout << "reload failed: " << e.what() << endl;
+				}
+				loading = false;
+			});
+			continue;
+		}
+		int boardSize = size, seed;
+		string second, extra;
+		bool valid;
+		if(in >> second)
+		{
+			valid = !(in >> extra) && parseInt(cmd, 1, MAX_SERVE_SIZE, boardSize) &&
+			        parseInt(second, INT_MIN, INT_MAX, seed);
+		}
+		else valid = parseInt(cmd, INT_MIN, INT_MAX, seed);
+		if(!valid)
+		{
+			lock_guard<mutex> guard(outLock);
+			cout << "bad request: expected \"<seed>\" or \"<size> <seed>\" with size 1.." << MAX_SERVE_SIZE << endl;
+			continue;
+		}
+		shared_ptr<const Solver> solver = atomic_load(&current);
+		set<string> found;
+		try
+		{
+			found = solver->solve(genBoard(boardSize, seed));
+		}
+		catch(const exception& e)
+		{
+			solver.reset();
+			lock_guard<mutex> guard(outLock);
+			cout << "seed " << seed << ": solve failed: " << e.what() << endl;
+			continue;
+		}
+		solver.reset();
+		lock_guard<mutex> guard(outLock);
+		cout << "seed " << seed << ": found " << found.size() << " words: " << joinWords(found) << endl;
+	}
+	if(loader.joinable()) loader.join();
+	return 0;
+}
+
 int main(int argc, char* argv[])
 {
 	if(argc < 4)
 	{
-		cout << "Usage: boggle-driver <size> <seed> <dictionary file>" << endl;
+		cout << "Usage: boggle-driver <size> <seed> <dictionary file> [-m] [-f] [-t] [-c row col] [-b boards [-j workers]] [-s]" << endl;
+		cout << "  -m  report memory used by the dictionary structures" << endl;
+		cout << "  -f  reject non-prefix walks with an xor filter before set lookups" << endl;
+		cout << "  -t  search a trie, pruned by the board's letters, instead of the sets" << endl;
+		cout << "  -c  also list the words passing through cell (row, col), via a GADDAG" << endl;
+		cout << "  -b  solve boards for seeds seed .. seed+boards-1 in forked worker processes" << endl;
+		cout << "  -j  number of worker processes for -b (default: online CPUs)" << endl;
+		cout << "  -s  serve boards for seeds read from stdin; \"reload <file>\" swaps dictionaries" << endl;
 		exit(1);
 	}
 	int size = atoi(argv[1]);
 	int seed = atoi(argv[2]);
-	vector<vector<char> > board = genBoard(size, seed);
-	printBoard(board);
-	pair<set<string>, set<string> > parsed = parseDict(string(argv[3]));
-	set<string> dictionary = parsed.first;
-	set<string> prefix = parsed.second;
-	set<string> found = boggle(dictionary, prefix, board);
-	set<string>::iterator it;
-	stringstream os;
-	for(it=found.begin();it != found.end(); ++it)
+	bool reportMem = false;
+	bool useFilter = false;
+	bool useTrie = false;
+	bool serveMode = false;
+	int cellRow = -1, cellCol = -1;
+	int boards = 0;
+	int workers = int(sysconf(_SC_NPROCESSORS_ONLN));
+	for(int i=4;i<argc;i++)
 	{
-		os << *it << ", ";
+		if(string(argv[i]) == "-m") reportMem = true;
+		else if(string(argv[i]) == "-f") useFilter = true;
+		else if(string(argv[i]) == "-t") useTrie = true;
+		else if(string(argv[i]) == "-c" && i+2 < argc)
+		{
+			cellRow = atoi(argv[++i]);
+			cellCol = atoi(argv[++i]);
+		}
+		else if(string(argv[i]) == "-b" && i+1 < argc) boards = atoi(argv[++i]);
+		else if(string(argv[i]) == "-j" && i+1 < argc) workers = atoi(argv[++i]);
+		else if(string(argv[i]) == "-s") serveMode = true;
+	}
+	if(workers < 1) workers = 1;
+	vector<vector<char> > board;
+	if(boards == 0 && !serveMode)
+	{
+		board = genBoard(size, seed);
+		printBoard(board);
+	}
+	shared_ptr<Solver> loaded = loadSolver(string(argv[3]), useFilter, useTrie);
+	const Solver& solver = *loaded;
+	const set<string>& dictionary = solver.dictionary;
+	const set<string>& prefix = solver.prefix;
+	if(reportMem)
+	{
+		cout << "dict:   " << dictionary.size() << " words, " << dictMemoryUsage(dictionary) << endl;
+		cout << "prefix: " << prefix.size() << " prefixes, " << dictMemoryUsage(prefix) << endl;
+		if(useFilter) cout << "filter: " << solver.filter.bytes() << " bytes" << endl;
+		if(useTrie) cout << "trie:   " << solver.trie->size() << " nodes, " << solver.trie->memoryUsage() << endl;
+	}
+	if(serveMode)
+	{
+		return serve(move(loaded), size, useFilter, useTrie);
 	}
+	if(boards > 0)
+	{
+		return runBatch(solver, size, seed, boards, workers);
+	}
+	set<string> found = solver.solve(board);
 	cout << "Found " << found.size() << " words:" << endl;
-	cout << os.str().substr(0,os.str().size()-2) << endl;
+	cout << joinWords(found) << endl;
+	if(cellRow >= 0 && cellCol >= 0)
+	{
+		Gaddag gaddag(dictionary, size);
+		if(reportMem) cout << "gaddag: " << gaddag.size() << " nodes, " << gaddag.memoryUsage() << endl;
+		vector<PlacedWord> placed = wordsThroughCell(gaddag, board, cellRow, cellCol);
+		cout << "Through (" << cellRow << "," << cellCol << "):";
+		for(size_t i=0;i<placed.size();i++)
+		{
+			cout << " " << placed[i].word << "@" << placed[i].r << "," << placed[i].c
+			     << (placed[i].dr ? (placed[i].dc ? "\\" : "|") : "-");
+		}
+		cout << endl;
+	}
 }
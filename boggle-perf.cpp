@@ -0,0 +1,172 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <set>
+#include <cstdlib>
+#include <thread>
+
+#include "boggle.h"
+#include "perf.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	if(argc < 4)
+	{
+		cout << "Usage: boggle-perf <size> <boards> <dictionary file> [-p] [-j threads]" << endl;
+		cout << "  -p          read hardware performance counters around each phase" << endl;
+		cout << "  -j threads  worker threads sharing the line cache (default 1)" << endl;
+		exit(1);
+	}
+	int size = atoi(argv[1]);
+	int boards = atoi(argv[2]);
+	PerfCounters counters;
+	PerfCounters* pc = nullptr;
+	unsigned int threads = 1;
+	for(int i=4;i<argc;i++)
+	{
+		if(string(argv[i]) == "-p") pc = &counters;
+		else if(string(argv[i]) == "-j" && i+1 < argc) threads = atoi(argv[++i]);
+	}
+	if(threads == 0) threads = 1;
+	if(pc && !counters.available())
+	{
+		cout << "hardware counters unavailable (check perf_event_paranoid); reporting wall time only" << endl;
+		pc = nullptr;
+	}
+
+	BenchPhase load(pc);
+	pair<set<string>, set<string> > parsed = parseDict(string(argv[3]));
+	load.done("parseDict", parsed.first.size());
+
+	vector<vector<vector<char> > > generated;
+	for(int seed=0;seed<boards;seed++)
+	{
+		generated.push_back(genBoard(size, seed));
+	}
+
+	size_t found = 0;
+	BenchPhase sets(pc);
+	for(size_t b=0;b<generated.size();b++)
+	{
+		found += boggle(parsed.first, parsed.second, generated[b]).size();
+	}
+	sets.done("boggle (sets)", generated.size());
+
+	XorFilter<> filter = buildDictFilter(parsed.first, parsed.second);
+	size_t foundFiltered = 0;
+	BenchPhase filtered(pc);
+	for(size_t b=0;b<generated.size();b++)
+	{
+		foundFiltered += boggle(parsed.first, parsed.second, filter, generated[b]).size();
+	}
+	filtered.done("boggle (xor filter)", generated.size());
+
+	DictTrie trie(parsed.first);
+	size_t foundTrie = 0;
+	BenchPhase trieFull(pc);
+	for(size_t b=0;b<generated.size();b++)
+	{
+		foundTrie += boggle(trie, generated[b], false).size();
+	}
+	trieFull.done("boggle (trie)", generated.size());
+
+	size_t foundPruned = 0;
+	BenchPhase triePruned(pc);
+	for(size_t b=0;b<generated.size();b++)
+	{
+		foundPruned += boggle(trie, generated[b]).size();
+	}
+	triePruned.done("boggle (trie, letter pruning)", generated.size());
+
+	// every found word passes through its first cell, so the union of the
+	// cell-anchored queries over a board is its whole result
+	BenchPhase gaddagBuild(pc);
+	Gaddag gaddag(parsed.first, size);
+	gaddagBuild.done("gaddag build", gaddag.words());
+	size_t foundGaddag = 0;
+	size_t cellQueries = 0;
+	BenchPhase anchored(pc);
+	for(size_t b=0;b<generated.size();b++)
+	{
+		set<string> words;
+		for(int r=0;r<size;r++)
+		{
+			for(int c=0;c<size;c++)
+			{
+				vector<PlacedWord> placed = wordsThroughCell(gaddag, generated[b], r, c);
+				for(size_t i=0;i<placed.size();i++) words.insert(placed[i].word);
+				cellQueries++;
+			}
+		}
+		foundGaddag += words.size();
+	}
+	anchored.done("gaddag (words through each cell)", cellQueries);
+
+	// One line cache shared by all workers, each solving every threads-th
+	// board. The counters follow only the thread that opened them, so one
+	// worker runs on this thread and several are timed by wall clock alone.
+	LineCache cache;
+	vector<size_t> foundPer(threads, 0);
+	auto solveShare = [&](unsigned int t) {
+		for(size_t b=t;b<generated.size();b+=threads)
+		{
+			foundPer[t] += boggle(parsed.first, parsed.second, cache, generated[b]).size();
+		}
+	};
+	if(pc && threads > 1) cout << "  (no counters for the line cache phase: it runs " << threads << " threads)" << endl;
+	BenchPhase cached(threads == 1 ? pc : nullptr);
+	if(threads == 1) solveShare(0);
+	else
+	{
+		vector<thread> workers;
+		for(unsigned int t=0;t<threads;t++) workers.push_back(thread(solveShare, t));
+		for(unsigned int t=0;t<threads;t++) workers[t].join();
+	}
+	cached.done("boggle (line cache)", generated.size());
+	size_t foundCached = 0;
+	for(unsigned int t=0;t<threads;t++) foundCached += foundPer[t];
+	size_t lookups = cache.hits() + cache.misses();
+	cout << "  line cache: " << cache.hits() << " hits of " << lookups << " lookups ("
+	     << (lookups ? 100.0 * cache.hits() / lookups : 0.0) << "%)" << endl;
+
+	cout << "found " << found << " words (" << foundFiltered
+	     << " with filter, " << foundTrie << " trie, " << foundPruned << " pruned trie, " << foundGaddag << " gaddag, "
+	     << foundCached << " with line cache)" << endl;
+
+	// Equal counts can hide one solver dropping a word and adding another,
+	// so compare every solver's words with the sets' board by board.
+	LineCache checkCache;
+	size_t mismatches = 0;
+	for(size_t b=0;b<generated.size();b++)
+	{
+		const vector<vector<char> >& board = generated[b];
+		set<string> expected = boggle(parsed.first, parsed.second, board);
+		set<string> anchoredWords;
+		for(int r=0;r<size;r++)
+		{
+			for(int c=0;c<size;c++)
+			{
+				vector<PlacedWord> placed = wordsThroughCell(gaddag, board, r, c);
+				for(size_t i=0;i<placed.size();i++) anchoredWords.insert(placed[i].word);
+			}
+		}
+		const pair<const char*, set<string> > results[] = {
+			make_pair("xor filter", boggle(parsed.first, parsed.second, filter, board)),
+			make_pair("trie", boggle(trie, board, false)),
+			make_pair("trie, letter pruning", boggle(trie, board)),
+			make_pair("gaddag", anchoredWords),
+			make_pair("line cache", boggle(parsed.first, parsed.second, checkCache, board))
+		};
+		for(size_t i=0;i<sizeof(results)/sizeof(results[0]);i++)
+		{
+			if(results[i].second == expected) continue;
+			cout << "board " << b << ": " << results[i].first << " differs from the sets" << endl;
+			mismatches++;
+		}
+	}
+	if(mismatches) cout << mismatches << " solver results differ from the sets" << endl;
+	else cout << "every solver matches the sets on every board" << endl;
+	return mismatches ? 1 : 0;
+}
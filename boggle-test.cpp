@@ -0,0 +1,207 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <set>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+
+#include "boggle.h"
+
+using namespace std;
+
+// Simple assert with exception on failure
+void assert_true(bool cond, const string& msg = "")
+{
+	if(!cond) throw runtime_error(msg);
+}
+
+#define TEST_CASE(name) \
+	cout << "[TEST] " << name << " ... "; \
+	try {
+
+#define END_TEST() \
+		cout << "PASS" << endl; \
+	} catch (const exception& e) { \
+		cout << "FAIL (" << e.what() << ")" << endl; \
+	}
+
+// CATSUP and QUIZ use letters neither board has
+const char* const WORDS[] = {
+	"CAT", "CATS", "CATSUP", "AT", "TO", "TON", "ON", "CAR", "CART", "AX", "AXE",
+	"AXES", "OX", "TEA", "TEAS", "SO", "ZOO", "QUIZ", "EAT", "ARE", "RE", "NO",
+	"NOT", "SEAT", "XE"
+};
+
+// C A T S
+// A X O N
+// R E A T
+// T Q S E
+const char* const ROWS4[] = {"CATS", "AXON", "REAT", "TQSE"};
+
+// each walk keeps only its longest word: CAT is inside CATS' walk and
+// AXE's walk stops at AXEQ, so CAT and AXES are not reported
+const char* const EXPECTED4[] = {"AT", "AX", "AXE", "CART", "CATS", "EAT", "ON", "RE", "TO", "XE"};
+
+// S E A T O
+// O T E A X
+// N O X E S
+// T E A R T
+// C A R T S
+const char* const ROWS5[] = {"SEATO", "OTEAX", "NOXES", "TEART", "CARTS"};
+
+// SEATO and TEAR are not prefixes, so those walks keep SEAT and TEA
+const char* const EXPECTED5[] = {"AT", "AX", "CART", "EAT", "NO", "ON", "OX", "SEAT", "SO", "TEA", "TO", "XE"};
+
+vector<vector<char> > makeBoard(const char* const* rows, unsigned int n)
+{
+	vector<vector<char> > board;
+	for(unsigned int r=0;r<n;r++) board.push_back(vector<char>(rows[r], rows[r] + n));
+	return board;
+}
+
+// dictionary and prefix sets as parseDict builds them
+pair<set<string>, set<string> > testDict()
+{
+	pair<set<string>, set<string> > parsed;
+	for(size_t i=0;i<sizeof(WORDS)/sizeof(WORDS[0]);i++)
+	{
+		string w(WORDS[i]);
+		parsed.first.insert(w);
+		for(size_t len=1;len<w.size();len++) parsed.second.insert(w.substr(0, len));
+	}
+	parsed.second.insert("");
+	return parsed;
+}
+
+set<string> expected4()
+{
+	return set<string>(EXPECTED4, EXPECTED4 + sizeof(EXPECTED4)/sizeof(EXPECTED4[0]));
+}
+
+set<string> expected5()
+{
+	return set<string>(EXPECTED5, EXPECTED5 + sizeof(EXPECTED5)/sizeof(EXPECTED5[0]));
+}
+
+// Test 1: the set-based solvers
+void testSetSolvers()
+{
+	pair<set<string>, set<string> > dict = testDict();
+	vector<vector<char> > board = makeBoard(ROWS4, 4);
+	assert_true(boggle(dict.first, dict.second, board) == expected4(), "boggle (sets)");
+	XorFilter<> filter = buildDictFilter(dict.first, dict.second);
+	assert_true(boggle(dict.first, dict.second, filter, board) == expected4(), "xor filter");
+}
+
+// Test 2: cached lines give the same words, cold and warm
+void testLineCache()
+{
+	pair<set<string>, set<string> > dict = testDict();
+	vector<vector<char> > board = makeBoard(ROWS4, 4);
+	LineCache cache;
+	assert_true(boggle(dict.first, dict.second, cache, board) == expected4(), "cold cache");
+	assert_true(cache.hits() == 0, "nothing to hit on a cold cache");
+	assert_true(boggle(dict.first, dict.second, cache, board) == expected4(), "warm cache");
+	// 4 rows, 4 columns and 7 diagonals
+	assert_true(cache.hits() == 15, "every line hits when warm");
+	// the 5x5 board shares no line with the 4x4 one
+	vector<vector<char> > board5 = makeBoard(ROWS5, 5);
+	assert_true(boggle(dict.first, dict.second, cache, board5) == expected5(), "second board");
+
+	// without CATS the same lines hold other words; the warm entries must not leak
+	pair<set<string>, set<string> > other = dict;
+	other.first.erase("CATS");
+	set<string> expectedOther = boggle(other.first, other.second, board);
+	assert_true(expectedOther.count("CAT") && !expectedOther.count("CATS"), "CAT kept without CATS");
+	size_t hits = cache.hits();
+	assert_true(boggle(other.first, other.second, cache, board) == expectedOther, "another dictionary");
+	assert_true(cache.hits() == hits, "no hits on another dictionary's lines");
+	assert_true(boggle(dict.first, dict.second, cache, board) == expected4(), "first dictionary again");
+}
+
+// Test 3: the set solver on a 5x5 board, and one with walks of a single cell
+void testBoardSizes()
+{
+	pair<set<string>, set<string> > dict = testDict();
+	assert_true(boggle(dict.first, dict.second, makeBoard(ROWS5, 5)) == expected5(), "5x5");
+	const char* const tiny[] = {"A"};
+	assert_true(boggle(dict.first, dict.second, makeBoard(tiny, 1)).empty(), "1x1");
+}
+
+// Test 4: trie walks, with and without letter pruning
+void testTrieSolvers()
+{
+	DictTrie trie(testDict().first);
+	vector<vector<char> > board4 = makeBoard(ROWS4, 4), board5 = makeBoard(ROWS5, 5);
+	assert_true(boggle(trie, board4, false) == expected4(), "trie 4x4");
+	assert_true(boggle(trie, board4) == expected4(), "trie 4x4, letter pruning");
+	assert_true(boggle(trie, board5, false) == expected5(), "trie 5x5");
+	assert_true(boggle(trie, board5) == expected5(), "trie 5x5, letter pruning");
+}
+
+// "WORD r c dr dc" for each word through (r,c), sorted
+vector<string> placedAt(const Gaddag& gaddag, const vector<vector<char> >& board, unsigned int r, unsigned int c)
+{
+	vector<PlacedWord> placed = wordsThroughCell(gaddag, board, r, c);
+	vector<string> out;
+	for(size_t i=0;i<placed.size();i++)
+	{
+		const PlacedWord& p = placed[i];
+		out.push_back(p.word + " " + to_string(p.r) + " " + to_string(p.c) + " " + to_string(p.dr) + " " + to_string(p.dc));
+	}
+	sort(out.begin(), out.end());
+	return out;
+}
+
+vector<string> strings(const char* const* first, size_t n)
+{
+	return vector<string>(first, first + n);
+}
+
+// Test 5: the GADDAG reports exactly the kept walks covering a cell
+void testWordsThroughCell()
+{
+	Gaddag gaddag(testDict().first, 5);
+	vector<vector<char> > board = makeBoard(ROWS4, 4);
+	const char* const center[] = {"AX 1 0 0 1", "AXE 0 1 1 0", "XE 1 1 1 0"};
+	assert_true(placedAt(gaddag, board, 1, 1) == strings(center, 3), "center cell");
+	const char* const corner[] = {"CART 0 0 1 0", "CATS 0 0 0 1"};
+	assert_true(placedAt(gaddag, board, 0, 0) == strings(corner, 2), "top-left corner");
+	assert_true(placedAt(gaddag, board, 3, 3).empty(), "bottom-right corner is in no word");
+	const char* const edge[] = {"AT 0 1 0 1", "CATS 0 0 0 1", "TO 0 2 1 0"};
+	assert_true(placedAt(gaddag, board, 0, 2) == strings(edge, 3), "top edge");
+	const char* const left[] = {"CART 0 0 1 0"};
+	assert_true(placedAt(gaddag, board, 3, 0) == strings(left, 1), "word ending on the bottom corner");
+	assert_true(placedAt(gaddag, board, 4, 0).empty(), "cell off the board");
+
+	set<string> all;
+	vector<vector<char> > board5 = makeBoard(ROWS5, 5);
+	for(unsigned int r=0;r<5;r++)
+	{
+		for(unsigned int c=0;c<5;c++)
+		{
+			vector<PlacedWord> placed = wordsThroughCell(gaddag, board5, r, c);
+			for(size_t i=0;i<placed.size();i++) all.insert(placed[i].word);
+		}
+	}
+	assert_true(all == expected5(), "union over every cell");
+
+	vector<vector<char> > blank(4, vector<char>(4, 'Z'));
+	bool none = true;
+	for(unsigned int r=0;r<4;r++)
+	{
+		for(unsigned int c=0;c<4;c++) none = none && wordsThroughCell(gaddag, blank, r, c).empty();
+	}
+	assert_true(none, "board with no words");
+}
+
+int main()
+{
+	TEST_CASE("Set solvers") testSetSolvers(); END_TEST();
+	TEST_CASE("Line cache") testLineCache(); END_TEST();
+	TEST_CASE("Board sizes") testBoardSizes(); END_TEST();
+	TEST_CASE("Trie solvers") testTrieSolvers(); END_TEST();
+	TEST_CASE("Words through a cell") testWordsThroughCell(); END_TEST();
+	return 0;
+}
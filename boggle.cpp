@@ -7,6 +7,8 @@
 #include <iomanip>
 #include <fstream>
 #include <exception>
+#include <functional>
+#include <algorithm>
 #endif
 
 #include "boggle.h"
@@ -75,6 +77,308 @@ std::pair<std::set<std::string>, std::set<std::string> > parseDict(std::string f
 	return make_pair(dict, prefix);
 }
 
+MemoryUsage dictMemoryUsage(const std::set<std::string>& words)
+{
+	// each std::set node is a red-black tree header (color + 3 links) plus the key
+	MemoryUsage mu;
+	mu.nodeBytes = words.size() * (4 * sizeof(void*) + sizeof(std::string));
+	for(std::set<std::string>::const_iterator it = words.begin(); it != words.end(); ++it)
+	{
+		mu.heapBytes += heapBytes(*it);
+	}
+	return mu;
+}
+
+// filter over every word and prefix: a walk whose string is in neither set
+// is rejected without searching either one
+XorFilter<> buildDictFilter(const std::set<std::string>& dict, const std::set<std::string>& prefix)
+{
+	std::hash<std::string> h;
+	std::vector<uint64_t> keys;
+	keys.reserve(dict.size() + prefix.size());
+	for(std::set<std::string>::const_iterator it = dict.begin(); it != dict.end(); ++it)
+	{
+		keys.push_back(h(*it));
+	}
+	for(std::set<std::string>::const_iterator it = prefix.begin(); it != prefix.end(); ++it)
+	{
+		keys.push_back(h(*it));
+	}
+	return XorFilter<>(keys);
+}
+
+std::set<std::string> boggle(const std::set<std::string>& dict, const std::set<std::string>& prefix, const XorFilter<>& filter, const std::vector<std::vector<char> >& board)
+{
+	std::set<std::string> result;
+	for(unsigned int i=0;i<board.size();i++)
+	{
+		for(unsigned int j=0;j<board.size();j++)
+		{
+			boggleHelper(dict, prefix, board, "", result, i, j, 0, 1, &filter);
+			boggleHelper(dict, prefix, board, "", result, i, j, 1, 0, &filter);
+			boggleHelper(dict, prefix, board, "", result, i, j, 1, 1, &filter);
+		}
+	}
+	return result;
+}
+
+LineCache::LineCache(std::size_t capacity, unsigned int stripes)
+{
+	if(stripes == 0) stripes = 1;
+	std::size_t per = (capacity + stripes - 1) / stripes;
+	for(unsigned int i=0;i<stripes;i++)
+	{
+		stripes_.push_back(std::unique_ptr<Stripe>(new Stripe(per)));
+	}
+}
+
+bool LineCache::encode(const std::string& line, uint64_t& key)
+{
+	if(line.size() > MAX_LINE) return false;
+	key = 0;
+	for(unsigned int i=0;i<line.size();i++)
+	{
+		if(line[i] < 'A' || line[i] > 'Z') return false;
+		key = (key << 5) | uint64_t(line[i] - 'A' + 1);
+	}
+	return true;
+}
+
+uint64_t LineCache::dictionaryId(const std::set<std::string>& dict, const std::set<std::string>& prefix)
+{
+	std::hash<std::string> h;
+	uint64_t id = mixHash(reinterpret_cast<uintptr_t>(&dict)) ^ mixHash(reinterpret_cast<uintptr_t>(&prefix) + 1);
+	id = mixHash(id ^ dict.size()) ^ prefix.size();
+	if(!dict.empty()) id = mixHash(id ^ h(*dict.begin())) ^ h(*dict.rbegin());
+	return mixHash(id);
+}
+
+// the key's letter count gives the length of the packed result
+bool LineCache::get(uint64_t dictId, uint64_t key, LineResult& out)
+{
+	uint64_t packed;
+	{
+		Stripe& s = stripeOf(key);
+		std::lock_guard<std::mutex> guard(s.lock);
+		Entry* e = s.cache.get(key);
+		if(!e) return false;
+		if(e->dictId != dictId)
+		{
+			s.stale++;
+			return false;
+		}
+		packed = e->packed;
+	}
+	unsigned int len = 0;
+	for(uint64_t k=key;k;k>>=5) len++;
+	out.resize(len);
+	for(unsigned int i=0;i<len;i++) out[i] = (packed >> (4 * i)) & 0xf;
+	return true;
+}
+
+void LineCache::put(uint64_t dictId, uint64_t key, const LineResult& result)
+{
+	Entry e;
+	e.dictId = dictId;
+	e.packed = 0;
+	for(unsigned int i=0;i<result.size();i++) e.packed |= uint64_t(result[i]) << (4 * i);
+	Stripe& s = stripeOf(key);
+	std::lock_guard<std::mutex> guard(s.lock);
+	s.cache.put(key, e);
+}
+
+std::size_t LineCache::hits() const
+{
+	std::size_t n = 0;
+	for(unsigned int i=0;i<stripes_.size();i++)
+	{
+		std::lock_guard<std::mutex> guard(stripes_[i]->lock);
+		n += stripes_[i]->cache.stats().hits - stripes_[i]->stale;
+	}
+	return n;
+}
+
+std::size_t LineCache::misses() const
+{
+	std::size_t n = 0;
+	for(unsigned int i=0;i<stripes_.size();i++)
+	{
+		std::lock_guard<std::mutex> guard(stripes_[i]->lock);
+		n += stripes_[i]->cache.stats().misses + stripes_[i]->stale;
+	}
+	return n;
+}
+
+// every row, column and down-right diagonal, read in walk direction
+std::vector<std::string> boardLines(const std::vector<std::vector<char> >& board)
+{
+	unsigned int n = board.size();
+	std::vector<std::string> lines;
+	for(unsigned int i=0;i<n;i++)
+	{
+		std::string row, col;
+		for(unsigned int j=0;j<n;j++)
+		{
+			row.push_back(board[i][j]);
+			col.push_back(board[j][i]);
+		}
+		lines.push_back(row);
+		lines.push_back(col);
+	}
+	// diagonals start on the top row or the left column
+	for(unsigned int d=0;d<2*n-1;d++)
+	{
+		unsigned int r = d < n ? 0 : d - n + 1;
+		unsigned int c = d < n ? d : 0;
+		std::string diag;
+		for(;r<n && c<n;r++,c++) diag.push_back(board[r][c]);
+		lines.push_back(diag);
+	}
+	return lines;
+}
+
+// the walk boggleHelper makes from every offset of a single line
+LineResult solveLine(const std::set<std::string>& dict, const std::set<std::string>& prefix, const std::string& line)
+{
+	LineResult result(line.size(), 0);
+	for(unsigned int s=0;s<line.size();s++)
+	{
+		std::string word;
+		for(unsigned int k=s;k<line.size();k++)
+		{
+			word.push_back(line[k]);
+			if(dict.find(word) != dict.end()) result[s] = word.size();
+			if(prefix.find(word) == prefix.end()) break;
+		}
+	}
+	return result;
+}
+
+// Same words as boggle(): each row, column and down-right diagonal is one
+// line whose suffixes are exactly the walks started on it, so the whole
+// line is solved (or fetched from the cache) at once.
+std::set<std::string> boggle(const std::set<std::string>& dict, const std::set<std::string>& prefix, LineCache& cache, const std::vector<std::vector<char> >& board)
+{
+	std::set<std::string> result;
+	std::vector<std::string> lines = boardLines(board);
+	const uint64_t dictId = LineCache::dictionaryId(dict, prefix);
+	LineResult lr;
+	for(unsigned int l=0;l<lines.size();l++)
+	{
+		uint64_t key;
+		bool cacheable = LineCache::encode(lines[l], key);
+		if(!cacheable || !cache.get(dictId, key, lr))
+		{
+			lr = solveLine(dict, prefix, lines[l]);
+			if(cacheable) cache.put(dictId, key, lr);
+		}
+		for(unsigned int s=0;s<lr.size();s++)
+		{
+			if(lr[s]) result.insert(lines[l].substr(s, lr[s]));
+		}
+	}
+	return result;
+}
+
+// cells left on the walk from (r,c) in direction (dr,dc), (r,c) included
+constexpr unsigned int walkLength(unsigned int n, unsigned int r, unsigned int c, unsigned int dr, unsigned int dc)
+{
+	return (dr && dc) ? n - (r > c ? r : c) : (dr ? n - r : n - c);
+}
+
+uint32_t boardLetterMask(const std::vector<std::vector<char> >& board)
+{
+	uint32_t mask = 0;
+	for(unsigned int i=0;i<board.size();i++)
+	{
+		mask |= DictTrie::letterMask(std::string(board[i].begin(), board[i].end()));
+	}
+	return mask;
+}
+
+// Same walks as boggle() over the trie. With prune set, a walk also stops
+// at a node whose every word needs a letter missing from the board, which
+// cuts most of the dictionary out of small boards.
+std::set<std::string> boggle(const DictTrie& trie, const std::vector<std::vector<char> >& board, bool prune)
+{
+	static const unsigned int DR[3] = {0, 1, 1};
+	static const unsigned int DC[3] = {1, 0, 1};
+	const unsigned int n = board.size();
+	const uint32_t missing = prune ? (~boardLetterMask(board) & DictTrie::ALL_LETTERS) : 0;
+	std::set<std::string> result;
+	for(unsigned int r=0;r<n;r++)
+	{
+		for(unsigned int c=0;c<n;c++)
+		{
+			for(unsigned int d=0;d<3;d++)
+			{
+				const unsigned int len = walkLength(n, r, c, DR[d], DC[d]);
+				uint32_t node = trie.root();
+				unsigned int best = 0;
+				for(unsigned int k=0;k<len;k++)
+				{
+					node = trie.child(node, board[r + k * DR[d]][c + k * DC[d]]);
+					if(node == DictTrie::NONE || (trie.required(node) & missing)) break;
+					if(trie.isWord(node)) best = k + 1;
+				}
+				if(best)
+				{
+					std::string word;
+					for(unsigned int k=0;k<best;k++) word.push_back(board[r + k * DR[d]][c + k * DC[d]]);
+					result.insert(word);
+				}
+			}
+		}
+	}
+	return result;
+}
+
+// The words boggle() reports whose walk covers (r,c), in time proportional
+// to those words rather than to every start that can reach the cell. For
+// each direction, the GADDAG is read backwards from the cell to each
+// possible start s, then across the separator and forwards past the cell.
+// The longest word found for s is the one boggle() keeps for that start:
+// any word from s through (r,c) is longer than any from s that stops short.
+std::vector<PlacedWord> wordsThroughCell(const Gaddag& gaddag, const std::vector<std::vector<char> >& board, unsigned int r, unsigned int c)
+{
+	static const unsigned int DR[3] = {0, 1, 1};
+	static const unsigned int DC[3] = {1, 0, 1};
+	const unsigned int n = board.size();
+	std::vector<PlacedWord> placed;
+	if(r >= n || c >= n) return placed;
+	for(unsigned int d=0;d<3;d++)
+	{
+		const unsigned int behind = (DR[d] && DC[d]) ? std::min(r, c) : (DR[d] ? r : c);
+		const unsigned int ahead = walkLength(n, r, c, DR[d], DC[d]);
+		uint32_t node = gaddag.root();
+		for(unsigned int back=0;back<=behind;back++)
+		{
+			node = gaddag.child(node, board[r - back * DR[d]][c - back * DC[d]]);
+			if(node == Gaddag::NONE) break;
+			uint32_t fwd = gaddag.child(node, Gaddag::SEPARATOR);
+			if(fwd == Gaddag::NONE) continue;
+			unsigned int best = gaddag.isWord(fwd) ? back + 1 : 0;
+			for(unsigned int f=1;f<ahead;f++)
+			{
+				fwd = gaddag.child(fwd, board[r + f * DR[d]][c + f * DC[d]]);
+				if(fwd == Gaddag::NONE) break;
+				if(gaddag.isWord(fwd)) best = back + 1 + f;
+			}
+			if(best)
+			{
+				PlacedWord pw;
+				pw.r = r - back * DR[d];
+				pw.c = c - back * DC[d];
+				pw.dr = DR[d];
+				pw.dc = DC[d];
+				for(unsigned int k=0;k<best;k++) pw.word.push_back(board[pw.r + k * pw.dr][pw.c + k * pw.dc]);
+				placed.push_back(pw);
+			}
+		}
+	}
+	return placed;
+}
+
 std::set<std::string> boggle(const std::set<std::string>& dict, const std::set<std::string>& prefix, const std::vector<std::vector<char> >& board)
 {
 	std::set<std::string> result;
@@ -99,7 +403,8 @@ bool boggleHelper(const std::set<std::string>& dict,
                   unsigned int r,
                   unsigned int c,
                   int dr,
-                  int dc)
+                  int dc,
+                  const XorFilter<>* filter)
 {
     unsigned int n = board.size();
     // 1) out of bounds?
@@ -108,6 +413,11 @@ bool boggleHelper(const std::set<std::string>& dict,
     // 2) append current letter (board and dict are both upper‐case)
     word.push_back(board[r][c]);
 
+    // 2b) a definite miss in the filter is neither a word nor a prefix
+    if (filter && !filter->mayContain(std::hash<std::string>()(word))) {
+        return false;
+    }
+
     // 3) check if this is a dict word, or at least a prefix of one
     bool isWord   = (dict.find(word)   != dict.end());
     bool isPrefix = (prefix.find(word) != prefix.end());
@@ -124,7 +434,7 @@ bool boggleHelper(const std::set<std::string>& dict,
             foundLonger = boggleHelper(
                 dict, prefix, board,
                 word, result,
-                nr, nc, dr, dc
+                nr, nc, dr, dc, filter
             );
         }
     }
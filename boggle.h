@@ -6,11 +6,91 @@
 #include <set>
 #include <utility>
 #include <string>
+#include <mutex>
+#include <memory>
+#include <cstdint>
 #endif
 
+#include "alloc.h"
+#include "filter.h"
+#include "cache.h"
+#include "trie.h"
+#include "gaddag.h"
+
+// Words along one line of the board under the longest-word-per-start rule:
+// entry s is the length of the word starting at offset s, 0 if none.
+typedef std::vector<unsigned char> LineResult;
+
+// a found word and the walk that spells it
+struct PlacedWord
+{
+	std::string word;
+	unsigned int r, c;  // first letter
+	unsigned int dr, dc;
+};
+
+struct LineKeyHash
+{
+	std::size_t operator()(uint64_t key) const { return mixHash(key); }
+};
+
+// Batch-level memo of LineResults keyed by the line's letters, packed five
+// bits each, so lines of up to MAX_LINE letters fit one 64-bit key; the
+// result is packed four bits per start into a 64-bit value. Each entry
+// also records the dictionary it was solved against, and get() treats an
+// entry from another dictionary as a miss, so one cache can be reused
+// across dictionaries. Striped over independently locked CLOCK caches so
+// worker threads can share it.
+class LineCache
+{
+public:
+	static const std::size_t MAX_LINE = 12;
+
+	LineCache(std::size_t capacity = 1 << 16, unsigned int stripes = 16);
+
+	// false when the line is too long or holds a letter outside A-Z
+	static bool encode(const std::string& line, uint64_t& key);
+
+	// Cheap identity of a dictionary: the sets' addresses, sizes and first
+	// and last entries, so it costs nothing per board. A different or
+	// reloaded dictionary gets a different id unless it matches all of these.
+	static uint64_t dictionaryId(const std::set<std::string>& dict, const std::set<std::string>& prefix);
+
+	bool get(uint64_t dictId, uint64_t key, LineResult& out);
+	void put(uint64_t dictId, uint64_t key, const LineResult& result);
+	std::size_t hits() const;
+	std::size_t misses() const;
+
+private:
+	struct Entry
+	{
+		uint64_t dictId;
+		uint64_t packed;
+	};
+	struct Stripe
+	{
+		std::mutex lock;
+		ClockCache<uint64_t, Entry, LinearProber<uint64_t>, LineKeyHash> cache;
+		std::size_t stale;  // cache hits on another dictionary's entry
+		Stripe(std::size_t capacity) : cache(capacity), stale(0) {}
+	};
+	Stripe& stripeOf(uint64_t key) const { return *stripes_[mixHash(key ^ 0x5bd1e995ULL) % stripes_.size()]; }
+
+	std::vector<std::unique_ptr<Stripe> > stripes_;
+};
+
 std::vector<std::vector<char> > genBoard(unsigned int n, int seed);
 void printBoard(const std::vector<std::vector<char> >& board);
 std::pair<std::set<std::string>, std::set<std::string> > parseDict(std::string fname);
 std::set<std::string> boggle(const std::set<std::string>& dict, const std::set<std::string>& prefix, const std::vector<std::vector<char> >& board);
-bool boggleHelper(const std::set<std::string>& dict, const std::set<std::string>& prefix, const std::vector<std::vector<char> >& board, std::string word, std::set<std::string>& result, unsigned int r, unsigned int c, int dr, int dc);
+std::set<std::string> boggle(const std::set<std::string>& dict, const std::set<std::string>& prefix, const XorFilter<>& filter, const std::vector<std::vector<char> >& board);
+std::set<std::string> boggle(const std::set<std::string>& dict, const std::set<std::string>& prefix, LineCache& cache, const std::vector<std::vector<char> >& board);
+std::set<std::string> boggle(const DictTrie& trie, const std::vector<std::vector<char> >& board, bool prune = true);
+std::vector<PlacedWord> wordsThroughCell(const Gaddag& gaddag, const std::vector<std::vector<char> >& board, unsigned int r, unsigned int c);
+std::vector<std::string> boardLines(const std::vector<std::vector<char> >& board);
+uint32_t boardLetterMask(const std::vector<std::vector<char> >& board);
+LineResult solveLine(const std::set<std::string>& dict, const std::set<std::string>& prefix, const std::string& line);
+MemoryUsage dictMemoryUsage(const std::set<std::string>& words);
+XorFilter<> buildDictFilter(const std::set<std::string>& dict, const std::set<std::string>& prefix);
+bool boggleHelper(const std::set<std::string>& dict, const std::set<std::string>& prefix, const std::vector<std::vector<char> >& board, std::string word, std::set<std::string>& result, unsigned int r, unsigned int c, int dr, int dc, const XorFilter<>* filter = nullptr);
 #endif
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+
+#include "ht.h"
+
+// -----------------------------------------------------------------------------
+// Capacity-bounded cache with CLOCK (second chance) eviction. A HashTable
+// maps each key to an entry index; keys, values and reference bits live in
+// parallel side arrays, so there are no per-entry list nodes.
+// -----------------------------------------------------------------------------
+
+template<
+    typename K,
+    typename V,
+    typename Prober = LinearProber<K>,
+    typename Hash = std::hash<K>,
+    typename KEqual = std::equal_to<K>
+>
+class ClockCache {
+public:
+    struct Stats {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+    };
+
+    ClockCache(size_t capacity,
+               const Prober& prober = Prober(),
+               const Hash& hash = Hash(),
+               const KEqual& kequal = KEqual())
+      : index_(0.5, prober, hash, kequal), capacity_(capacity), hand_(0),
+        hits_(0), misses_(0), evictions_(0)
+    {
+        if (capacity == 0) throw std::invalid_argument("ClockCache capacity must be positive");
+        keys_.reserve(capacity);
+        values_.reserve(capacity);
+        ref_.reserve(capacity);
+    }
+
+    size_t size() const { return keys_.size(); }
+    size_t capacity() const { return capacity_; }
+
+    // value for key (marked recently used), or nullptr on a miss
+    V* get(const K& key) {
+        auto it = index_.find(key);
+        if (!it) { ++misses_; return nullptr; }
+        ++hits_;
+        ref_[it->second] = 1;
+        return &values_[it->second];
+    }
+
+    // insert or overwrite key; evicts one entry when the cache is full
+    void put(const K& key, const V& value) {
+        auto it = index_.find(key);
+        if (it) {
+            values_[it->second] = value;
+            ref_[it->second] = 1;
+            return;
+        }
+        size_t slot;
+        if (keys_.size() < capacity_) {
+            slot = keys_.size();
+            keys_.push_back(key);
+            values_.push_back(value);
+            ref_.push_back(0);
+        } else {
+            slot = evict();
+            keys_[slot] = key;
+            values_[slot] = value;
+            ref_[slot] = 0;
+        }
+        index_.insert({key, slot});
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.hits = hits_;
+        s.misses = misses_;
+        s.evictions = evictions_;
+        return s;
+    }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage mu = index_.memoryUsage();
+        mu.slotBytes += keys_.capacity() * sizeof(K) + values_.capacity() * sizeof(V)
+                      + ref_.capacity();
+        for (size_t i = 0; i < keys_.size(); ++i)
+            mu.heapBytes += heapBytes(keys_[i]) + heapBytes(values_[i]);
+        return mu;
+    }
+
+private:
+    // sweep the hand past referenced entries, clearing their bits, and
+    // free the first unreferenced one
+    size_t evict() {
+        while (ref_[hand_]) {
+            ref_[hand_] = 0;
+            hand_ = (hand_ + 1) % capacity_;
+        }
+        size_t victim = hand_;
+        hand_ = (hand_ + 1) % capacity_;
+        index_.remove(keys_[victim]);
+        ++evictions_;
+        return victim;
+    }
+
+    HashTable<K, size_t, Prober, Hash, KEqual> index_;
+    std::vector<K> keys_;
+    std::vector<V> values_;
+    std::vector<uint8_t> ref_;
+    size_t capacity_;
+    size_t hand_;
+    size_t hits_;
+    size_t misses_;
+    size_t evictions_;
+};
+
+#endif // CACHE_H
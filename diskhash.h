@@ -0,0 +1,571 @@
+#ifndef DISKHASH_H
+#define DISKHASH_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ht.h"
+#include "filter.h"
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// Disk-resident hash table: linear hashing over page-sized buckets in one
+// memory-mapped file, for key sets larger than memory.
+//
+// Page 0 holds the header (magic "HTDISK02", page count, base_, split_,
+// element and record-byte counts, hash id). Every other page starts with a
+// PageHeader naming its bucket and kind (primary, overflow or free) and
+// the next page of its bucket's chain, followed by records of the 8-byte
+// full hash, a 2-byte length and the key and value in trace.h's
+// writeKey encoding. Buckets split one at a time as in linearhash.h once
+// the records fill maxFill of the primary pages. A bucket whose page is
+// full chains overflow pages until its turn to split comes. Removes never
+// merge buckets; overflow pages they empty go on a free list for reuse.
+//
+// Only the bucket -> primary page directory and a Bloom filter of key
+// hashes live in memory. Opening an existing file rebuilds both with one
+// scan of the pages. A miss usually costs no page read, and a hit costs
+// about one. The file is durable after sync() but is not crash-atomic;
+// pages written since the last sync() may be partially on disk.
+//
+// Stored hashes pick each record's bucket, so the file is only readable
+// with the hash that wrote it. The default DiskKeyHash depends on nothing
+// but the key's bytes; std::hash may change between builds. load() rejects
+// a file whose header hash id differs from the table's, and checks the
+// first record of every page against the table's hash, which also catches
+// custom hashes that have no id.
+// -----------------------------------------------------------------------------
+
+static const char DISKHASH_MAGIC[8] = {'H','T','D','I','S','K','0','2'};
+
+// FNV-1a over the key's bytes (what writeKey writes, less the string
+// length), finished with the MurmurHash3 mixer: FNV's low bits depend only
+// on the low bits of each byte, and the low bits choose the bucket.
+struct DiskKeyHash {
+    static uint64_t bytes(const char* data, size_t len) {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < len; ++i) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 1099511628211ull;
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+    template<typename K>
+    typename std::enable_if<std::is_arithmetic<K>::value, uint64_t>::type
+    operator()(const K& key) const { return bytes(reinterpret_cast<const char*>(&key), sizeof(key)); }
+    uint64_t operator()(const std::string& key) const { return bytes(key.data(), key.size()); }
+};
+
+// the id a file records for its hash; 0 means the hash has none
+template<typename Hash> struct DiskHashId { static const uint64_t value = 0; };
+template<> struct DiskHashId<DiskKeyHash> { static const uint64_t value = 0x31564e46; };  // "FNV1"
+
+template<
+    typename K,
+    typename V,
+    typename Hash = DiskKeyHash,
+    typename KEqual = std::equal_to<K>
+>
+class DiskHashTable {
+public:
+    typedef K KeyType;
+    typedef V ValueType;
+    typedef std::pair<KeyType,ValueType> ItemType;
+
+    static const size_t PAGE_SIZE = 4096;
+    static const size_t INITIAL_BUCKETS = 4;
+
+    struct Stats {
+        size_t size;          // live elements
+        size_t buckets;
+        size_t pages;         // pages in the file, header and free pages included
+        size_t overflowPages;
+        size_t freePages;
+        size_t pageReads;     // pages visited by lookups since opening
+        size_t filtered;      // lookups answered by the filter without a page read
+        size_t splits;
+    };
+
+    // Open path, creating an empty table when it does not exist. maxFill is
+    // the fraction of primary page space records may use before a split.
+    DiskHashTable(const std::string& path, double maxFill = 0.75,
+                  const Hash& hash = Hash(), const KEqual& kequal = KEqual())
+      : hash_(hash), kequal_(kequal), maxFill_(maxFill), path_(path), fd_(-1),
+        map_(nullptr), mappedPages_(0), pages_(0), base_(INITIAL_BUCKETS), split_(0),
+        elementCount_(0), recordBytes_(0), filterCapacity_(0), pageReads_(0),
+        filtered_(0), splits_(0)
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+        // the destructor will not run, so a failed open must unmap and close here
+        try {
+            struct stat st;
+            if (::fstat(fd_, &st) != 0) fail("cannot stat " + path);
+            if (st.st_size == 0) create();
+            else load(size_t(st.st_size));
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~DiskHashTable() {
+        if (map_) writeHeader();
+        release();
+    }
+
+    DiskHashTable(const DiskHashTable&) = delete;
+    DiskHashTable& operator=(const DiskHashTable&) = delete;
+
+    bool empty() const { return elementCount_ == 0; }
+    size_t size() const { return elementCount_; }
+    size_t bucketCount() const { return base_ + split_; }
+
+    Stats stats() const {
+        Stats s;
+        s.size = elementCount_;
+        s.buckets = bucketCount();
+        s.pages = pages_;
+        s.overflowPages = pages_ - 1 - bucketCount() - freePages_.size();
+        s.freePages = freePages_.size();
+        s.pageReads = pageReads_;
+        s.filtered = filtered_;
+        s.splits = splits_;
+        return s;
+    }
+
+    // in-memory bytes: the bucket directory and the filter (pages are in the file)
+    MemoryUsage memoryUsage() const {
+        MemoryUsage mu;
+        mu.slotBytes = directory_.capacity() * sizeof(uint32_t) +
+                       freePages_.capacity() * sizeof(uint32_t);
+        mu.filterBytes = filter_.bytes();
+        return mu;
+    }
+
+    size_t fileBytes() const { return pages_ * PAGE_SIZE; }
+
+    // Insert or overwrite. A record (encoded key and value) must fit in a page.
+    void insert(const ItemType& p) {
+        uint64_t hv = hash_(p.first);
+        std::string payload = encode(p);
+        Location loc;
+        if (locate(p.first, hv, loc)) eraseAt(loc);
+        else ++elementCount_;
+        append(uint32_t(address(hv)), hv, payload);
+        noteHash(hv);
+        while (double(recordBytes_) > maxFill_ * double(bucketCount() * PAGE_DATA)) splitOne();
+    }
+
+    void remove(const KeyType& key) {
+        uint64_t hv = hash_(key);
+        Location loc;
+        if (!locate(key, hv, loc)) return;
+        eraseAt(loc);
+        --elementCount_;
+    }
+
+    // The returned item is a decoded copy, valid until the next call on
+    // this table; writes through it do not reach the file.
+    const ItemType* find(const KeyType& key) const {
+        uint64_t hv = hash_(key);
+        Location loc;
+        if (!locate(key, hv, loc)) return nullptr;
+        decode(loc.record, found_);
+        return &found_;
+    }
+
+    // call f(item) for every item, in bucket and page order
+    template<typename F>
+    void forEach(F f) const {
+        ItemType item;
+        for (size_t b = 0; b < bucketCount(); ++b) {
+            for (uint32_t p = directory_[b]; p; p = header(p)->next) {
+                const char* rec = page(p) + sizeof(PageHeader);
+                const char* end = rec + header(p)->used;
+                for (; rec < end; rec += recordSize(rec)) {
+                    decode(rec, item);
+                    f(static_cast<const ItemType&>(item));
+                }
+            }
+        }
+    }
+
+    // Fill an empty table from [first, last), whose keys must be distinct.
+    // One pass measures the records to size the buckets, the filter and
+    // the file for the primary pages up front; the second appends every
+    // record to its bucket with no duplicate checks or splits.
+    template<typename It>
+    void bulkLoad(It first, It last) {
+        if (!empty()) throw std::logic_error("bulkLoad needs an empty table");
+        size_t n = 0, bytes = 0;
+        for (It it = first; it != last; ++it) {
+            bytes += RECORD_HEADER + encode(*it).size();
+            ++n;
+        }
+        size_t buckets = std::max(size_t(INITIAL_BUCKETS),
+            size_t(double(bytes) / (maxFill_ * double(PAGE_DATA))) + 1);
+        growFile(pages_ + buckets);
+        while (bucketCount() < buckets) splitOne();
+        resetFilter(n);
+        for (It it = first; it != last; ++it) {
+            uint64_t hv = hash_(it->first);
+            append(uint32_t(address(hv)), hv, encode(*it));
+            filter_.add(hv);
+        }
+        elementCount_ = n;
+    }
+
+    // write the header and force every page to disk
+    void sync() {
+        writeHeader();
+        if (::msync(map_, pages_ * PAGE_SIZE, MS_SYNC) != 0) fail("cannot sync " + path_);
+    }
+
+private:
+    enum PageKind : uint8_t { PAGE_FREE, PAGE_PRIMARY, PAGE_OVERFLOW };
+
+    struct PageHeader {
+        uint32_t bucket;
+        uint32_t next;      // next page of the chain, 0 for none
+        uint16_t used;      // record bytes after the header
+        uint16_t records;
+        uint8_t kind;
+        uint8_t pad[3];
+    };
+
+    struct FileHeader {
+        char magic[8];
+        uint64_t pageSize;
+        uint64_t pages;
+        uint64_t base;
+        uint64_t split;
+        uint64_t elements;
+        uint64_t recordBytes;
+        uint64_t hashId;
+    };
+
+    // where locate() found a key: its page, the page before it in the
+    // chain (0 for the primary page) and the record itself
+    struct Location {
+        uint32_t page;
+        uint32_t prev;
+        const char* record;
+    };
+
+    static const size_t PAGE_DATA = PAGE_SIZE - sizeof(PageHeader);
+    static const size_t RECORD_HEADER = sizeof(uint64_t) + sizeof(uint16_t);
+    static const size_t GROW_PAGES = 64;
+
+    char* page(uint32_t p) const { return map_ + size_t(p) * PAGE_SIZE; }
+    PageHeader* header(uint32_t p) const { return reinterpret_cast<PageHeader*>(page(p)); }
+
+    static uint64_t recordHash(const char* rec) {
+        uint64_t hv;
+        std::memcpy(&hv, rec, sizeof(hv));
+        return hv;
+    }
+    static uint16_t payloadSize(const char* rec) {
+        uint16_t len;
+        std::memcpy(&len, rec + sizeof(uint64_t), sizeof(len));
+        return len;
+    }
+    static size_t recordSize(const char* rec) { return RECORD_HEADER + payloadSize(rec); }
+
+    size_t address(uint64_t hv) const {
+        size_t b = hv & (base_ - 1);
+        if (b < split_) b = hv & (2 * base_ - 1);
+        return b;
+    }
+
+    void release() {
+        if (map_) ::munmap(map_, mappedPages_ * PAGE_SIZE);
+        if (fd_ >= 0) ::close(fd_);
+        map_ = nullptr;
+        fd_ = -1;
+    }
+
+    void fail(const std::string& what) const {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    std::string encode(const ItemType& p) const {
+        record_.str("");
+        writeKey(record_, p.first);
+        writeKey(record_, p.second);
+        std::string payload = record_.str();
+        if (payload.size() > PAGE_DATA - RECORD_HEADER)
+            throw std::length_error("DiskHashTable record larger than a page");
+        return payload;
+    }
+
+    static void decode(const char* rec, ItemType& item) {
+        std::istringstream in(std::string(rec + RECORD_HEADER, payloadSize(rec)));
+        if (!readKey(in, item.first) || !readKey(in, item.second))
+            throw std::runtime_error("corrupt DiskHashTable record");
+    }
+
+    // Walk key's chain comparing stored hashes first, so only a hash match
+    // decodes a key. The filter skips the walk for most absent keys.
+    bool locate(const KeyType& key, uint64_t hv, Location& loc) const {
+        if (!filter_.mayContain(hv)) {
+            ++filtered_;
+            return false;
+        }
+        ItemType item;
+        uint32_t prev = 0;
+        for (uint32_t p = directory_[address(hv)]; p; prev = p, p = header(p)->next) {
+            ++pageReads_;
+            const char* rec = page(p) + sizeof(PageHeader);
+            const char* end = rec + header(p)->used;
+            for (; rec < end; rec += recordSize(rec)) {
+                if (recordHash(rec) != hv) continue;
+                decode(rec, item);
+                if (!kequal_(item.first, key)) continue;
+                loc.page = p;
+                loc.prev = prev;
+                loc.record = rec;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // drop a record, unlinking its page when an overflow page empties
+    void eraseAt(const Location& loc) {
+        PageHeader* h = header(loc.page);
+        char* rec = const_cast<char*>(loc.record);
+        size_t size = recordSize(rec);
+        char* end = page(loc.page) + sizeof(PageHeader) + h->used;
+        std::memmove(rec, rec + size, end - (rec + size));
+        h->used -= uint16_t(size);
+        h->records -= 1;
+        recordBytes_ -= size;
+        if (h->records == 0 && h->kind == PAGE_OVERFLOW) {
+            header(loc.prev)->next = h->next;
+            freePage(loc.page);
+        }
+    }
+
+    // add a record to the first page of bucket b with room, chaining a new
+    // overflow page when none has
+    void append(uint32_t b, uint64_t hv, const std::string& payload) {
+        size_t size = RECORD_HEADER + payload.size();
+        uint32_t p = directory_[b];
+        while (header(p)->used + size > PAGE_DATA) {
+            if (!header(p)->next) {
+                uint32_t q = allocPage(PAGE_OVERFLOW, b);
+                header(p)->next = q;
+            }
+            p = header(p)->next;
+        }
+        PageHeader* h = header(p);
+        char* rec = page(p) + sizeof(PageHeader) + h->used;
+        uint16_t len = uint16_t(payload.size());
+        std::memcpy(rec, &hv, sizeof(hv));
+        std::memcpy(rec + sizeof(hv), &len, sizeof(len));
+        std::memcpy(rec + RECORD_HEADER, payload.data(), payload.size());
+        h->used += uint16_t(size);
+        h->records += 1;
+        recordBytes_ += size;
+    }
+
+    // Move the records of bucket split_ whose next hash bit is set into a
+    // new bucket; overflow pages of the old chain are freed and reused.
+    void splitOne() {
+        uint32_t from = uint32_t(split_);
+        std::vector<char> records;
+        uint32_t p = directory_[from];
+        for (uint32_t q = p; q; ) {
+            PageHeader* h = header(q);
+            const char* data = page(q) + sizeof(PageHeader);
+            records.insert(records.end(), data, data + h->used);
+            uint32_t next = h->next;
+            if (q != p) freePage(q);
+            q = next;
+        }
+        header(p)->used = 0;
+        header(p)->records = 0;
+        header(p)->next = 0;
+        directory_.push_back(allocPage(PAGE_PRIMARY, uint32_t(from + base_)));
+        if (++split_ == base_) {
+            base_ *= 2;
+            split_ = 0;
+        }
+        ++splits_;
+        for (size_t off = 0; off < records.size(); ) {
+            const char* rec = &records[off];
+            size_t size = recordSize(rec);
+            recordBytes_ -= size;
+            uint64_t hv = recordHash(rec);
+            append(uint32_t(address(hv)), hv, std::string(rec + RECORD_HEADER, size - RECORD_HEADER));
+            off += size;
+        }
+    }
+
+    uint32_t allocPage(PageKind kind, uint32_t bucket) {
+        uint32_t p;
+        if (!freePages_.empty()) {
+            p = freePages_.back();
+            freePages_.pop_back();
+        } else {
+            if (pages_ == mappedPages_) growFile(std::max(size_t(GROW_PAGES), mappedPages_ * 2));
+            p = uint32_t(pages_++);
+        }
+        PageHeader* h = header(p);
+        std::memset(h, 0, sizeof(PageHeader));
+        h->bucket = bucket;
+        h->kind = kind;
+        return p;
+    }
+
+    void freePage(uint32_t p) {
+        header(p)->kind = PAGE_FREE;
+        header(p)->used = 0;
+        header(p)->records = 0;
+        header(p)->next = 0;
+        freePages_.push_back(p);
+    }
+
+    // extend the file and its mapping to at least want pages
+    void growFile(size_t want) {
+        if (want <= mappedPages_) return;
+        if (::ftruncate(fd_, off_t(want * PAGE_SIZE)) != 0) fail("cannot grow " + path_);
+        void* m = map_
+            ? ::mremap(map_, mappedPages_ * PAGE_SIZE, want * PAGE_SIZE, MREMAP_MAYMOVE)
+            : ::mmap(nullptr, want * PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (m == MAP_FAILED) fail("cannot map " + path_);
+        map_ = static_cast<char*>(m);
+        mappedPages_ = want;
+    }
+
+    // size the filter for twice n keys, so steady growth rebuilds it rarely
+    void resetFilter(size_t n) {
+        filterCapacity_ = std::max<size_t>(2 * n, 1024);
+        filter_.reset(filterCapacity_, 0.01);
+    }
+
+    void noteHash(uint64_t hv) {
+        if (elementCount_ <= filterCapacity_) {
+            filter_.add(hv);
+            return;
+        }
+        resetFilter(elementCount_);
+        for (uint32_t p = 1; p < pages_; ++p) {
+            if (header(p)->kind == PAGE_FREE) continue;
+            const char* rec = page(p) + sizeof(PageHeader);
+            const char* end = rec + header(p)->used;
+            for (; rec < end; rec += recordSize(rec)) filter_.add(recordHash(rec));
+        }
+    }
+
+    void create() {
+        growFile(GROW_PAGES);
+        pages_ = 1;
+        for (size_t b = 0; b < INITIAL_BUCKETS; ++b)
+            directory_.push_back(allocPage(PAGE_PRIMARY, uint32_t(b)));
+        resetFilter(0);
+        writeHeader();
+    }
+
+    // map an existing file and rebuild the directory, free list and filter
+    void load(size_t bytes) {
+        if (bytes % PAGE_SIZE != 0) throw std::runtime_error("not a DiskHashTable file: " + path_);
+        growFile(bytes / PAGE_SIZE);
+        FileHeader fh;
+        std::memcpy(&fh, map_, sizeof(fh));
+        if (std::memcmp(fh.magic, DISKHASH_MAGIC, sizeof(fh.magic)) != 0 || fh.pageSize != PAGE_SIZE ||
+            fh.pages > mappedPages_ || fh.base == 0 || (fh.base & (fh.base - 1)) || fh.split >= fh.base)
+            throw std::runtime_error("not a DiskHashTable file: " + path_);
+        if (fh.hashId != DiskHashId<Hash>::value)
+            throw std::runtime_error("DiskHashTable written with a different hash: " + path_);
+        pages_ = fh.pages;
+        base_ = fh.base;
+        split_ = fh.split;
+        elementCount_ = fh.elements;
+        recordBytes_ = fh.recordBytes;
+        directory_.assign(bucketCount(), 0);
+        resetFilter(elementCount_);
+        for (uint32_t p = 1; p < pages_; ++p) {
+            PageHeader* h = header(p);
+            if (h->kind == PAGE_FREE) {
+                freePages_.push_back(p);
+                continue;
+            }
+            if (h->bucket >= bucketCount() || h->used > PAGE_DATA || h->next >= pages_)
+                throw std::runtime_error("corrupt DiskHashTable page in " + path_);
+            if (h->kind == PAGE_PRIMARY) directory_[h->bucket] = p;
+            const char* rec = page(p) + sizeof(PageHeader);
+            const char* end = rec + h->used;
+            for (; rec < end; rec += recordSize(rec)) {
+                if (size_t(end - rec) < RECORD_HEADER || recordSize(rec) > size_t(end - rec))
+                    throw std::runtime_error("corrupt DiskHashTable record in " + path_);
+                if (rec == page(p) + sizeof(PageHeader)) {
+                    ItemType item;
+                    decode(rec, item);
+                    if (uint64_t(hash_(item.first)) != recordHash(rec))
+                        throw std::runtime_error("DiskHashTable written with a different hash: " + path_);
+                }
+                filter_.add(recordHash(rec));
+            }
+        }
+        if (std::find(directory_.begin(), directory_.end(), 0u) != directory_.end())
+            throw std::runtime_error("DiskHashTable bucket without a page in " + path_);
+    }
+
+    void writeHeader() {
+        FileHeader fh;
+        std::memset(&fh, 0, sizeof(fh));
+        std::memcpy(fh.magic, DISKHASH_MAGIC, sizeof(fh.magic));
+        fh.pageSize = PAGE_SIZE;
+        fh.pages = pages_;
+        fh.base = base_;
+        fh.split = split_;
+        fh.elements = elementCount_;
+        fh.recordBytes = recordBytes_;
+        fh.hashId = DiskHashId<Hash>::value;
+        std::memcpy(map_, &fh, sizeof(fh));
+    }
+
+    Hash hash_;
+    KEqual kequal_;
+    double maxFill_;
+    std::string path_;
+    int fd_;
+    char* map_;
+    size_t mappedPages_;
+    size_t pages_;     // pages in use, header included
+    size_t base_;      // buckets at the start of this round, a power of two
+    size_t split_;     // next bucket to split
+    size_t elementCount_;
+    size_t recordBytes_;
+    std::vector<uint32_t> directory_;
+    std::vector<uint32_t> freePages_;
+    BloomFilter filter_;
+    size_t filterCapacity_;
+    mutable size_t pageReads_;
+    mutable size_t filtered_;
+    size_t splits_;
+    mutable std::ostringstream record_;
+    mutable ItemType found_;
+};
+
+#endif // DISKHASH_H
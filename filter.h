@@ -0,0 +1,170 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+#include "alloc.h"
+
+// -----------------------------------------------------------------------------
+// Approximate-membership filters: a "no" is definite, a "yes" may be wrong.
+// Both take an already computed 64-bit key hash and remix it, so weak table
+// hashes (e.g. std::hash<int>) still spread well.
+// -----------------------------------------------------------------------------
+
+// splitmix64 finalizer
+inline uint64_t mixHash(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// map x uniformly onto [0, n) without a division
+inline uint32_t reduceRange(uint32_t x, uint32_t n) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(x) * n) >> 32);
+}
+
+// Blocked Bloom filter: all k bits of a key sit in one 64-byte block, so a
+// query touches a single cache line. Supports incremental adds.
+class BloomFilter {
+public:
+    static const size_t BLOCK_WORDS = CACHE_LINE_SIZE / sizeof(uint64_t);
+    static const size_t BLOCK_BITS = BLOCK_WORDS * 64;
+
+    BloomFilter(size_t expected = 0, double fpRate = 0.01) { reset(expected, fpRate); }
+
+    // clear and size for about expected keys at the given false-positive rate
+    void reset(size_t expected, double fpRate) {
+        if (fpRate <= 0.0 || fpRate >= 1.0) throw std::invalid_argument("fpRate must be in (0,1)");
+        double n = double(std::max<size_t>(expected, 1));
+        double ln2 = std::log(2.0);
+        double bits = -n * std::log(fpRate) / (ln2 * ln2);
+        blocks_ = static_cast<uint32_t>(std::ceil(bits / BLOCK_BITS));
+        if (blocks_ == 0) blocks_ = 1;
+        k_ = static_cast<unsigned>(std::lround(bits / n * ln2));
+        k_ = std::min(16u, std::max(1u, k_));
+        bits_.assign(size_t(blocks_) * BLOCK_WORDS, 0);
+    }
+
+    void add(uint64_t key) {
+        uint64_t* block = &bits_[blockOf(key) * BLOCK_WORDS];
+        uint64_t h = mixHash(key ^ 0x9e3779b97f4a7c15ULL);
+        uint32_t a = uint32_t(h), b = uint32_t(h >> 32) | 1;
+        for (unsigned i = 0; i < k_; ++i, a += b)
+            block[(a % BLOCK_BITS) / 64] |= uint64_t(1) << (a % 64);
+    }
+
+    bool mayContain(uint64_t key) const {
+        const uint64_t* block = &bits_[blockOf(key) * BLOCK_WORDS];
+        uint64_t h = mixHash(key ^ 0x9e3779b97f4a7c15ULL);
+        uint32_t a = uint32_t(h), b = uint32_t(h >> 32) | 1;
+        for (unsigned i = 0; i < k_; ++i, a += b)
+            if (!(block[(a % BLOCK_BITS) / 64] & (uint64_t(1) << (a % 64)))) return false;
+        return true;
+    }
+
+    size_t bytes() const { return allocatedBytes(bits_.capacity() * sizeof(uint64_t)); }
+    unsigned hashCount() const { return k_; }
+
+private:
+    size_t blockOf(uint64_t key) const {
+        return reduceRange(uint32_t(mixHash(key) >> 32), blocks_);
+    }
+
+    std::vector<uint64_t, HugePageAllocator<uint64_t> > bits_;
+    uint32_t blocks_;
+    unsigned k_;
+};
+
+// Static xor filter (Graf & Lemire) over a fixed key set. Uses about
+// 1.23 * bits(Fingerprint) bits per key; false-positive rate is
+// 2^-bits(Fingerprint), so uint8_t gives ~0.4% and uint16_t ~0.0015%.
+template<typename Fingerprint = uint8_t>
+class XorFilter {
+public:
+    XorFilter() : seed_(0), blockLength_(0) {}
+    explicit XorFilter(std::vector<uint64_t> keys) : seed_(0), blockLength_(0) { build(keys); }
+
+    void build(std::vector<uint64_t> keys) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        size_t size = keys.size();
+        blockLength_ = static_cast<uint32_t>((32 + std::ceil(1.23 * size)) / 3);
+        size_t capacity = size_t(blockLength_) * 3;
+
+        std::vector<uint64_t> xorMask(capacity);
+        std::vector<uint32_t> count(capacity);
+        std::vector<uint32_t> queue;
+        std::vector<std::pair<uint64_t,uint32_t> > stack;
+        for (int attempt = 0; ; ++attempt) {
+            if (attempt == 64) throw std::logic_error("XorFilter construction failed");
+            seed_ = mixHash(seed_ + 0x9e3779b97f4a7c15ULL);
+            std::fill(xorMask.begin(), xorMask.end(), 0);
+            std::fill(count.begin(), count.end(), 0);
+            for (uint64_t key : keys) {
+                uint64_t h = mixHash(key + seed_);
+                for (int i = 0; i < 3; ++i) {
+                    uint32_t s = slot(h, i);
+                    xorMask[s] ^= h;
+                    ++count[s];
+                }
+            }
+            // peel slots hit by exactly one key
+            queue.clear();
+            stack.clear();
+            for (uint32_t s = 0; s < capacity; ++s)
+                if (count[s] == 1) queue.push_back(s);
+            while (!queue.empty()) {
+                uint32_t s = queue.back();
+                queue.pop_back();
+                if (count[s] != 1) continue;
+                uint64_t h = xorMask[s];
+                stack.push_back(std::make_pair(h, s));
+                for (int i = 0; i < 3; ++i) {
+                    uint32_t t = slot(h, i);
+                    xorMask[t] ^= h;
+                    if (--count[t] == 1) queue.push_back(t);
+                }
+            }
+            if (stack.size() == size) break;
+        }
+
+        fingerprints_.assign(capacity, 0);
+        for (size_t i = stack.size(); i-- > 0; ) {
+            uint64_t h = stack[i].first;
+            Fingerprint f = fingerprint(h);
+            for (int j = 0; j < 3; ++j) f ^= fingerprints_[slot(h, j)];
+            fingerprints_[stack[i].second] = f;
+        }
+    }
+
+    bool mayContain(uint64_t key) const {
+        if (fingerprints_.empty()) return false;
+        uint64_t h = mixHash(key + seed_);
+        Fingerprint f = fingerprint(h);
+        f ^= fingerprints_[slot(h, 0)] ^ fingerprints_[slot(h, 1)] ^ fingerprints_[slot(h, 2)];
+        return f == 0;
+    }
+
+    size_t bytes() const { return allocatedBytes(fingerprints_.capacity() * sizeof(Fingerprint)); }
+
+private:
+    static Fingerprint fingerprint(uint64_t h) { return Fingerprint(h ^ (h >> 32)); }
+
+    // one slot in each third of the array
+    uint32_t slot(uint64_t h, int i) const {
+        uint64_t r = (h << (21 * i)) | (h >> ((64 - 21 * i) & 63));
+        return reduceRange(uint32_t(r), blockLength_) + i * blockLength_;
+    }
+
+    uint64_t seed_;
+    uint32_t blockLength_;
+    std::vector<Fingerprint, HugePageAllocator<Fingerprint> > fingerprints_;
+};
+
+#endif // FILTER_H
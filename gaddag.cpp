@@ -0,0 +1,62 @@
+#ifndef RECCHECK
+#include <algorithm>
+#endif
+
+#include "gaddag.h"
+
+// Built through per-node edge lists kept in letter order, then flattened
+// so each node's edges are one contiguous run of edges_.
+Gaddag::Gaddag(const std::set<std::string>& dict, unsigned int maxLen) : words_(0)
+{
+	std::vector<std::vector<Edge> > children(1);
+	std::vector<bool> word(1, false);
+	for(std::set<std::string>::const_iterator it = dict.begin(); it != dict.end(); ++it)
+	{
+		const std::string& w = *it;
+		if(w.empty() || w.size() > maxLen) continue;
+		bool letters = true;
+		for(unsigned int i=0;i<w.size();i++) letters = letters && w[i] >= 'A' && w[i] <= 'Z';
+		if(!letters) continue;
+		words_++;
+		for(unsigned int split=1;split<=w.size();split++)
+		{
+			std::string path(w.rbegin() + (w.size() - split), w.rend());
+			path.push_back(SEPARATOR);
+			path.append(w, split, std::string::npos);
+			uint32_t node = 0;
+			for(unsigned int i=0;i<path.size();i++)
+			{
+				std::vector<Edge>& edges = children[node];
+				std::vector<Edge>::iterator e = edges.begin();
+				while(e != edges.end() && e->letter < path[i]) ++e;
+				if(e == edges.end() || e->letter != path[i])
+				{
+					Edge fresh;
+					fresh.letter = path[i];
+					fresh.target = children.size();
+					e = edges.insert(e, fresh);
+					children.push_back(std::vector<Edge>());
+					word.push_back(false);
+				}
+				node = e->target;
+			}
+			word[node] = true;
+		}
+	}
+	nodes_.resize(children.size());
+	for(uint32_t n=0;n<children.size();n++)
+	{
+		nodes_[n].firstEdge = edges_.size();
+		nodes_[n].edges = children[n].size();
+		nodes_[n].word = word[n];
+		edges_.insert(edges_.end(), children[n].begin(), children[n].end());
+		std::vector<Edge>().swap(children[n]);
+	}
+}
+
+MemoryUsage Gaddag::memoryUsage() const
+{
+	MemoryUsage mu;
+	mu.nodeBytes = nodes_.capacity() * sizeof(Node) + edges_.capacity() * sizeof(Edge);
+	return mu;
+}
@@ -0,0 +1,64 @@
+#ifndef GADDAG_H
+#define GADDAG_H
+
+#ifndef RECCHECK
+#include <vector>
+#include <set>
+#include <string>
+#include <cstdint>
+#endif
+
+#include "alloc.h"
+
+// GADDAG over A-Z: every word w is stored once per split point i as
+// reverse(w[0..i)) SEPARATOR w[i..), so a search anchored on any letter of
+// a word reads backwards from the anchor to the word's start, crosses the
+// separator and then reads forwards to its end. Nodes keep their edges
+// sorted in one flat array (at most 27 per node), which keeps the
+// structure compact; build it with maxLen set to the longest line a board
+// has, since no longer word can be placed.
+class Gaddag
+{
+public:
+	static const char SEPARATOR = '>';
+	static const uint32_t NONE = 0;
+
+	Gaddag(const std::set<std::string>& dict, unsigned int maxLen);
+
+	uint32_t root() const { return 0; }
+	uint32_t child(uint32_t node, char letter) const
+	{
+		const Node& n = nodes_[node];
+		for(uint32_t e=n.firstEdge;e<n.firstEdge+n.edges;e++)
+		{
+			if(edges_[e].letter == letter) return edges_[e].target;
+			if(edges_[e].letter > letter) break;
+		}
+		return NONE;
+	}
+	// true where a path that crossed the separator ends a word
+	bool isWord(uint32_t node) const { return nodes_[node].word; }
+
+	std::size_t size() const { return nodes_.size(); }
+	std::size_t words() const { return words_; }
+	MemoryUsage memoryUsage() const;
+
+private:
+	struct Node
+	{
+		uint32_t firstEdge;
+		uint8_t edges;
+		bool word;
+	};
+	struct Edge
+	{
+		char letter;
+		uint32_t target;
+	};
+
+	std::vector<Node> nodes_;
+	std::vector<Edge> edges_;
+	std::size_t words_;
+};
+
+#endif
@@ -114,4 +114,56 @@ TEST(HashFunc,TestRandomize){
 	}
 	set<size_t> hash_unique_vals(hash_values.begin(),hash_values.end());
 	EXPECT_EQ(hash_values.size(),hash_unique_vals.size());
-}
\ No newline at end of file
+}
+
+TEST(StringEqual,IgnoresAsciiCase){
+	MyStringEqual eq;
+	EXPECT_TRUE(eq("USCCS103LandCS104L","usccs103landcs104l"));
+	EXPECT_TRUE(eq("AntidisEstablishmentAriaNism","antidisestablishmentarianism"));
+	EXPECT_FALSE(eq("abc","abd"));
+	EXPECT_FALSE(eq("abc","abcd"));
+	EXPECT_TRUE(eq("",""));
+}
+
+TEST(StringEqual,OnlyLettersFold){
+	MyStringEqual eq;
+	// these pairs differ only in bit 0x20 but are not letters
+	EXPECT_FALSE(eq("@@@@@@@@@@@@@@@@@@@@","````````````````````"));
+	EXPECT_FALSE(eq("[[[[[[[[[[[[[[[[[[[[","{{{{{{{{{{{{{{{{{{{{"));
+	EXPECT_FALSE(eq("0123456789abcdefghijklmnop","0123456789ABCDEFGHIJKLMNOq"));
+}
+
+TEST(StringEqual,MatchesHash){
+	MyStringHash hashk(true);
+	MyStringEqual eq;
+	string k1("antidisestablishmentarianism");
+	string k2("ANTIDISESTABLISHMENTARIANISM");
+	EXPECT_TRUE(eq(k1,k2));
+	EXPECT_EQ(hashk(k1),hashk(k2));
+	foldAsciiCase(k2);
+	EXPECT_EQ(k1,k2);
+}
+
+TEST(HashVariants,MatchScalar){
+	MyStringHash hashk(true);
+	const char* keys[] = {"", "B", "abc", "abc123", "gfedcba", "abcdefghijkl",
+		"abcdefghijklm", "USCCS103LandCS104L", "antidisestablishmentarianism",
+		"9999999999999999999999999999", "thirtyonecharacterslongkeyvalue",
+		"a-b_c d!e@f#g$h%i^j&k*l(m)n+o=p?q", "AntidisEstablishmentAriaNism1234567890abcdefghijklmnop"};
+	for(size_t i = 0; i < sizeof(keys)/sizeof(keys[0]); i++){
+		string k(keys[i]);
+		EXPECT_EQ(hashk(k), hashk.hashTableDriven(k)) << k;
+		EXPECT_EQ(hashk(k), hashk.hashSimd(k)) << k;
+	}
+}
+
+TEST(HashVariants,MatchScalarRandomized){
+	MyStringHash hashk(false);
+	mt19937 gen(104);
+	for(int i = 0; i < 2000; i++){
+		string k(gen() % 65, ' ');
+		for(size_t j = 0; j < k.size(); j++) k[j] = static_cast<char>(gen() % 256);
+		EXPECT_EQ(hashk(k), hashk.hashTableDriven(k));
+		EXPECT_EQ(hashk(k), hashk.hashSimd(k));
+	}
+}
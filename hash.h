@@ -7,19 +7,52 @@
 #include <cctype>
 #include <random>
 #include <chrono>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 typedef std::size_t HASH_INDEX_T;
 
+#ifdef __SSE2__
+// lowercase the ASCII letters among 16 bytes, leave everything else alone
+inline __m128i foldAsciiCase16(__m128i v) {
+    // 'A'..'Z' become -128..-103 after the shift, the only bytes below -102
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(128 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+// base-36 digit of each of 16 bytes, as letterDigitToNumber maps them
+inline __m128i letterDigitToNumber16(__m128i v) {
+    v = foldAsciiCase16(v);
+    __m128i lower = _mm_cmplt_epi8(_mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(128 - 'a'))),
+                                   _mm_set1_epi8(-128 + 26));
+    __m128i digit = _mm_cmplt_epi8(_mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(128 - '0'))),
+                                   _mm_set1_epi8(-128 + 10));
+    __m128i fromLower = _mm_and_si128(lower, _mm_sub_epi8(v, _mm_set1_epi8('a')));
+    __m128i fromDigit = _mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0' - 26)));
+    return _mm_or_si128(fromLower, fromDigit);
+}
+#endif
+
 struct MyStringHash {
     // default debug values:
     HASH_INDEX_T rValues[5] {
         983132572u, 1468777056u, 552714139u, 984953261u, 261934300u
     };
 
+    // Only the last WINDOW characters are hashed. Right-aligned in that
+    // window, the character at position p contributes
+    // digit * rValues[p / 6] * 36^(5 - p % 6), which weights_ caches.
+    static const int WINDOW = 30;
+    HASH_INDEX_T weights_[WINDOW];
+
     MyStringHash(bool debug = true) {
         if (!debug) {
             generateRValues();
         }
+        computeWeights();
     }
 
     // --- your hash function ---
@@ -53,6 +86,63 @@ struct MyStringHash {
         return static_cast<HASH_INDEX_T>(h);
     }
 
+    // Same value as operator(), with the per-character work done by a
+    // 256-entry digit table and the chunk arithmetic by weights_.
+    HASH_INDEX_T hashTableDriven(const std::string& k) const {
+        const unsigned char* table = digitTable();
+        size_t take = std::min<size_t>(k.size(), WINDOW);
+        const unsigned char* src = reinterpret_cast<const unsigned char*>(k.data()) + k.size() - take;
+        const HASH_INDEX_T* w = weights_ + (WINDOW - take);
+        unsigned long long h = 0;
+        for (size_t i = 0; i < take; ++i) h += table[src[i]] * static_cast<unsigned long long>(w[i]);
+        return static_cast<HASH_INDEX_T>(h);
+    }
+
+    // Same value as operator(): the window is converted to digits 16 bytes
+    // at a time with SSE2 (table lookups without it), then weighted.
+    HASH_INDEX_T hashSimd(const std::string& k) const {
+#ifdef __SSE2__
+        // right-align the window in 32 bytes; zero padding is digit 0
+        alignas(16) unsigned char buf[32] = {0};
+        size_t take = std::min<size_t>(k.size(), WINDOW);
+        std::memcpy(buf + 32 - take, k.data() + k.size() - take, take);
+        __m128i* v = reinterpret_cast<__m128i*>(buf);
+        _mm_store_si128(v, letterDigitToNumber16(_mm_load_si128(v)));
+        _mm_store_si128(v + 1, letterDigitToNumber16(_mm_load_si128(v + 1)));
+        unsigned long long h = 0;
+        for (size_t p = WINDOW - take; p < size_t(WINDOW); ++p)
+            h += buf[32 - WINDOW + p] * static_cast<unsigned long long>(weights_[p]);
+        return static_cast<HASH_INDEX_T>(h);
+#else
+        return hashTableDriven(k);
+#endif
+    }
+
+    // letterDigitToNumber for every byte value
+    static const unsigned char* digitTable() {
+        static const struct Table {
+            unsigned char d[256];
+            Table() {
+                for (int c = 0; c < 256; ++c) {
+                    d[c] = 0;
+                    if (c >= 'a' && c <= 'z') d[c] = static_cast<unsigned char>(c - 'a');
+                    else if (c >= 'A' && c <= 'Z') d[c] = static_cast<unsigned char>(c - 'A');
+                    else if (c >= '0' && c <= '9') d[c] = static_cast<unsigned char>(c - '0' + 26);
+                }
+            }
+        } table;
+        return table.d;
+    }
+
+    // rebuild weights_ from rValues (call after changing rValues directly)
+    void computeWeights() {
+        for (int p = 0; p < WINDOW; ++p) {
+            unsigned long long pow36 = 1;
+            for (int j = p % 6; j < 5; ++j) pow36 *= 36;
+            weights_[p] = static_cast<HASH_INDEX_T>(rValues[p / 6] * pow36);
+        }
+    }
+
     // helper: map 'a'/'A'→0, 'b'→1, …, 'z'→25, '0'→26, …, '9'→35
     HASH_INDEX_T letterDigitToNumber(char c) const {
         if (std::isalpha(static_cast<unsigned char>(c))) {
@@ -75,6 +165,45 @@ struct MyStringHash {
         for (int i = 0; i < 5; ++i) {
             rValues[i] = gen();
         }
+        computeWeights();
+    }
+};
+
+inline char foldAsciiCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+// lowercase ASCII letters in place (the folding MyStringHash applies)
+inline void foldAsciiCase(std::string& s) {
+    size_t i = 0, n = s.size();
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&s[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&s[i]), foldAsciiCase16(v));
+    }
+#endif
+    for (; i < n; ++i) s[i] = foldAsciiCase(s[i]);
+}
+
+// ASCII case-insensitive equality: keys it calls equal always get the same
+// MyStringHash, so mixed-case variants share one table entry
+struct MyStringEqual {
+    bool operator()(const std::string& a, const std::string& b) const {
+        size_t n = a.size();
+        if (n != b.size()) return false;
+        const char* pa = a.data();
+        const char* pb = b.data();
+        size_t i = 0;
+#ifdef __SSE2__
+        for (; i + 16 <= n; i += 16) {
+            __m128i va = foldAsciiCase16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i)));
+            __m128i vb = foldAsciiCase16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) return false;
+        }
+#endif
+        for (; i < n; ++i)
+            if (foldAsciiCase(pa[i]) != foldAsciiCase(pb[i])) return false;
+        return true;
     }
 };
 
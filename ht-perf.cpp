@@ -0,0 +1,247 @@
+#include "ht.h"
+#include "hash.h"
+#include "trace.h"
+#include "perf.h"
+#include "linearhash.h"
+#include "diskhash.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <memory>
+
+using namespace std;
+
+// what to run and report for each table configuration
+struct Options {
+    bool reportMem;
+    bool useFilter;
+    OpObserver<string>* observer;  // -w: records the first configuration's calls
+    const Trace<string>* replay;   // -t: replaces the word workload
+    bool latency;                  // -l: per-operation latency percentiles
+    PerfCounters* counters;        // -p: hardware counters around each phase
+    Options() : reportMem(false), useFilter(false), observer(nullptr), replay(nullptr),
+                latency(false), counters(nullptr) {}
+};
+
+// insert every word, look all of them up, look up misses, remove half
+template<typename Table>
+void wordWorkload(Table& ht, const vector<string>& words, const vector<string>& misses,
+                  PerfCounters* counters) {
+    BenchPhase insert(counters);
+    for (size_t i = 0; i < words.size(); ++i) ht.insert({words[i], int(i)});
+    insert.done("insert", words.size());
+
+    size_t found = 0;
+    BenchPhase hit(counters);
+    for (const string& w : words) found += ht.find(w) != nullptr;
+    hit.done("find hit", words.size());
+
+    BenchPhase miss(counters);
+    for (const string& w : misses) found += ht.find(w) != nullptr;
+    miss.done("find miss", misses.size());
+
+    BenchPhase remove(counters);
+    for (size_t i = 0; i < words.size(); i += 2) ht.remove(words[i]);
+    remove.done("remove", (words.size() + 1) / 2);
+    cout << "  found " << found << endl;
+
+    // word counting: every word seen twice
+    Table counts(0.4);
+    BenchPhase count(counters);
+    for (const string& w : words) counts.increment(w, 1);
+    for (const string& w : words) counts.increment(w, 1);
+    count.done("increment", 2 * words.size());
+
+    // set operations against every third word, as in a dictionary diff
+    Table other(0.4);
+    for (size_t i = 0; i < words.size(); i += 3) other.insert({words[i], int(i)});
+    BenchPhase diff(counters);
+    ht.difference(other);
+    diff.done("difference", ht.stats().capacity);
+    BenchPhase merge(counters);
+    ht.merge(other);
+    merge.done("merge", other.stats().capacity);
+    BenchPhase intersect(counters);
+    ht.intersect(other);
+    intersect.done("intersect", ht.stats().capacity);
+    cout << "  after set operations " << ht.size() << endl;
+}
+
+template<typename Table>
+void runBench(const string& name, Table& ht, const vector<string>& words,
+              const vector<string>& misses, const Options& opt) {
+    cout << name << endl;
+    if (opt.useFilter) ht.enableFilter();
+    ht.setObserver(opt.observer);
+    HashLatency lat;
+    if (opt.latency) ht.setLatencyRecorder(&lat);
+    if (opt.replay) {
+        BenchPhase replay(opt.counters);
+        size_t hits = replayTrace(*opt.replay, ht);
+        replay.done("replay", opt.replay->ops.size());
+        cout << "  hits " << hits << ", final size " << ht.size() << endl;
+    } else {
+        wordWorkload(ht, words, misses, opt.counters);
+    }
+    ht.setObserver(nullptr);
+    ht.setLatencyRecorder(nullptr);
+
+    auto st = ht.stats();
+    cout << "  capacity " << st.capacity << ", probes " << st.probes
+         << ", resizes " << st.resizes << ", filtered " << st.filtered
+         << ", pages " << pageBackingName(st.backing) << endl;
+    if (opt.reportMem) cout << "  memory: " << ht.memoryUsage() << endl;
+    if (opt.latency) lat.report(cout, HASH_OP_NAMES);
+}
+
+// the word workload's insert/find/remove phases on a linear-hashing table,
+// whose growth is spread over the inserts instead of whole-table rehashes
+template<typename Table>
+void runLinearBench(const string& name, Table& ht, const vector<string>& words,
+                    const vector<string>& misses, const Options& opt) {
+    cout << name << endl;
+    HashLatency lat;
+    if (opt.latency) ht.setLatencyRecorder(&lat);
+    BenchPhase insert(opt.counters);
+    for (size_t i = 0; i < words.size(); ++i) ht.insert({words[i], int(i)});
+    insert.done("insert", words.size());
+    size_t found = 0;
+    BenchPhase hit(opt.counters);
+    for (const string& w : words) found += ht.find(w) != nullptr;
+    hit.done("find hit", words.size());
+    BenchPhase miss(opt.counters);
+    for (const string& w : misses) found += ht.find(w) != nullptr;
+    miss.done("find miss", misses.size());
+    cout << "  found " << found << endl;
+    auto st = ht.stats();
+    cout << "  buckets " << st.buckets << ", segments " << st.segments
+         << ", splits " << st.splits << ", longest chain " << st.longestChain << endl;
+    if (opt.reportMem) cout << "  memory: " << ht.memoryUsage() << endl;
+    BenchPhase remove(opt.counters);
+    for (size_t i = 0; i < words.size(); i += 2) ht.remove(words[i]);
+    remove.done("remove", (words.size() + 1) / 2);
+    ht.setLatencyRecorder(nullptr);
+    if (opt.latency) lat.report(cout, HASH_OP_NAMES);
+}
+
+// a disk-backed table filled by single inserts and by bulkLoad, then
+// queried; files are created at <path>.insert and <path>.bulk and removed
+void runDiskBench(const string& path, const vector<string>& words,
+                  const vector<string>& misses, const Options& opt) {
+    typedef DiskHashTable<string,int> DT;
+    string insertPath = path + ".insert", bulkPath = path + ".bulk";
+    unlink(insertPath.c_str());
+    unlink(bulkPath.c_str());
+    {
+        cout << "disk table, inserts" << endl;
+        DT dt(insertPath);
+        BenchPhase insert(opt.counters);
+        for (size_t i = 0; i < words.size(); ++i) dt.insert({words[i], int(i)});
+        insert.done("insert", words.size());
+        auto st = dt.stats();
+        cout << "  buckets " << st.buckets << ", pages " << st.pages
+             << ", overflow pages " << st.overflowPages << ", file " << dt.fileBytes() << " bytes" << endl;
+    }
+    cout << "disk table, bulk load" << endl;
+    vector<pair<string,int> > items;
+    for (size_t i = 0; i < words.size(); ++i) items.push_back({words[i], int(i)});
+    DT dt(bulkPath);
+    BenchPhase load(opt.counters);
+    dt.bulkLoad(items.begin(), items.end());
+    load.done("bulk load", items.size());
+    size_t found = 0;
+    BenchPhase hit(opt.counters);
+    for (const string& w : words) found += dt.find(w) != nullptr;
+    hit.done("find hit", words.size());
+    size_t reads = dt.stats().pageReads;
+    BenchPhase miss(opt.counters);
+    for (const string& w : misses) found += dt.find(w) != nullptr;
+    miss.done("find miss", misses.size());
+    auto st = dt.stats();
+    cout << "  found " << found << ", page reads per hit "
+         << double(reads) / double(words.size()) << ", misses filtered " << st.filtered << endl;
+    cout << "  buckets " << st.buckets << ", pages " << st.pages
+         << ", overflow pages " << st.overflowPages << ", file " << dt.fileBytes() << " bytes" << endl;
+    if (opt.reportMem) cout << "  memory: " << dt.memoryUsage() << endl;
+    unlink(insertPath.c_str());
+    unlink(bulkPath.c_str());
+}
+
+void usage() {
+    cout << "Usage: ht-perf [word file] [-m] [-f] [-l] [-p] [-w trace] [-t trace] [-d file]" << endl;
+    cout << "  -m        report memory usage" << endl;
+    cout << "  -f        put a Bloom filter in front of lookups" << endl;
+    cout << "  -l        report latency percentiles and resize pauses" << endl;
+    cout << "  -p        read hardware performance counters around each phase" << endl;
+    cout << "  -w trace  record the first configuration's calls to a trace file" << endl;
+    cout << "  -t trace  replay a recorded trace instead of the word workload" << endl;
+    cout << "  -d file   also run a disk-backed table in file.insert and file.bulk" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    string fname = "dict.txt", recordFile, replayFile, diskFile;
+    Options opt;
+    PerfCounters counters;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "-m") opt.reportMem = true;
+        else if (arg == "-f") opt.useFilter = true;
+        else if (arg == "-l") opt.latency = true;
+        else if (arg == "-p") opt.counters = &counters;
+        else if (arg == "-w" && i + 1 < argc) recordFile = argv[++i];
+        else if (arg == "-t" && i + 1 < argc) replayFile = argv[++i];
+        else if (arg == "-d" && i + 1 < argc) diskFile = argv[++i];
+        else fname = arg;
+    }
+
+    if (opt.counters && !counters.available()) {
+        cout << "hardware counters unavailable (check perf_event_paranoid); reporting wall time only" << endl;
+        opt.counters = nullptr;
+    }
+
+    vector<string> words, misses;
+    Trace<string> trace;
+    if (!replayFile.empty()) {
+        ifstream tin(replayFile.c_str(), ios::binary);
+        if (tin.fail()) { usage(); return 1; }
+        trace = readTrace<string>(tin);
+        opt.replay = &trace;
+        cout << "trace: " << trace.ops.size() << " calls over "
+             << trace.keys.size() << " keys" << endl;
+    } else {
+        ifstream in(fname.c_str());
+        if (in.fail()) { usage(); return 1; }
+        string w;
+        while (in >> w) {
+            words.push_back(w);
+            misses.push_back(w + "9");
+        }
+    }
+    ofstream tout;
+    unique_ptr<TraceRecorder<string> > recorder;
+    if (!recordFile.empty()) {
+        tout.open(recordFile.c_str(), ios::binary);
+        recorder.reset(new TraceRecorder<string>(tout));
+        opt.observer = recorder.get();
+    }
+
+    typedef DoubleHashProber<string,MyStringHash> DHP;
+    HashTable<string,int,LinearProber<string>,MyStringHash> linear(0.4);
+    runBench("linear probing, MyStringHash", linear, words, misses, opt);
+    opt.observer = nullptr;
+    HashTable<string,int,DHP,MyStringHash> dbl(0.4);
+    runBench("double hashing, MyStringHash", dbl, words, misses, opt);
+    HashTable<string,int,DHP,MyStringHash> single(0.4, DHP(MyStringHash(), true));
+    runBench("double hashing (single pass), MyStringHash", single, words, misses, opt);
+    HashTable<string,int> stdhash(0.4);
+    runBench("linear probing, std::hash", stdhash, words, misses, opt);
+    if (!opt.replay) {
+        LinearHashTable<string,int,MyStringHash> lh(1.0);
+        runLinearBench("linear hashing, MyStringHash", lh, words, misses, opt);
+        if (!diskFile.empty()) runDiskBench(diskFile, words, misses, opt);
+    }
+    return 0;
+}
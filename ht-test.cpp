@@ -1,5 +1,19 @@
 #include "ht.h"
 #include "hash.h"
+#include "filter.h"
+#include "cache.h"
+#include "trace.h"
+#include "wal.h"
+#include "versioned.h"
+#include "multimap.h"
+#include "linearhash.h"
+#include "diskhash.h"
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
 #include <iostream>
 #include <string>
 #include <stdexcept>
@@ -108,6 +122,544 @@ void testDoubleHashProber() {
     assert_true(ht.find("alpha") && ht.find("beta") && ht.find("gamma"), "double hashing keys found");
 }
 
+// Test 7: multithreaded resize keeps every live key
+void testParallelResize() {
+    HashTable<int,int> ht(0.4);
+    ht.setResizeThreads(4, 0);
+    for (int i = 0; i < 5000; i++) {
+        ht.insert({i, i*2});
+        if (i % 3 == 0) ht.remove(i);
+    }
+    assert_true(ht.size() == 5000 - 1667, "size after parallel resizes");
+    for (int i = 0; i < 5000; i++) {
+        auto p = ht.find(i);
+        if (i % 3 == 0) assert_true(p == nullptr, "removed key must stay gone");
+        else assert_true(p && p->second == i*2, "key must survive parallel resize");
+    }
+
+    DoubleHashProber<string,MyStringHash> dhp;
+    HashTable<string,int,DoubleHashProber<string,MyStringHash>,MyStringHash> hs(0.5, dhp);
+    hs.setResizeThreads(3, 0);
+    for (int i = 0; i < 2000; i++) hs.insert({"k" + to_string(i), i});
+    for (int i = 0; i < 2000; i++) {
+        auto p = hs.find("k" + to_string(i));
+        assert_true(p && p->second == i, "double-hashed key must survive parallel resize");
+    }
+}
+
+// Test 8: stats report capacity and page backing of the slot array
+void testStatsBacking() {
+    HashTable<int,int> ht(0.5);
+    ht.insert({1, 1});
+    auto st = ht.stats();
+    assert_true(st.size == 1 && st.capacity == 11 && st.resizes == 0, "small table stats");
+    assert_true(st.backing == PAGES_SMALL, "small table uses regular pages");
+    assert_true(reinterpret_cast<size_t>(ht.table_.data()) % CACHE_LINE_SIZE == 0,
+                "slot array is cache-line aligned");
+    for (int i = 0; i < 210000; i++) ht.insert({i, i});
+    st = ht.stats();
+    assert_true(st.capacity * sizeof(void*) >= HUGE_PAGE_THRESHOLD, "table grew past threshold");
+    assert_true(st.backing != PAGES_SMALL, "large table asks for huge pages");
+    assert_true(reinterpret_cast<size_t>(ht.table_.data()) % HUGE_PAGE_SIZE == 0,
+                "large slot array is 2MB aligned");
+    size_t slots = ht.memoryUsage().slotBytes;
+    assert_true(slots % HUGE_PAGE_SIZE == 0 && slots >= st.capacity * sizeof(void*),
+                "slot bytes include the 2MB padding");
+}
+
+// Test 9: memory accounting splits live nodes, heap keys and tombstones
+void testMemoryUsage() {
+    HashTable<string,int> ht(0.5);
+    ht.insert({"short", 1});
+    ht.insert({string(100, 'x'), 2});
+    auto mu = ht.memoryUsage();
+    typedef HashTable<string,int>::HashItem Item;
+    assert_true(mu.slotBytes == 11 * sizeof(Item*), "slot bytes");
+    assert_true(mu.nodeBytes == 2 * sizeof(Item), "two live nodes");
+    assert_true(mu.heapBytes >= 101, "long key owns a heap buffer");
+    assert_true(mu.tombstoneBytes == 0, "no tombstones yet");
+    ht.remove("short");
+    mu = ht.memoryUsage();
+    assert_true(mu.nodeBytes == sizeof(Item) && mu.tombstoneBytes == sizeof(Item),
+                "removed node counted as tombstone");
+    assert_true(mu.total() == mu.slotBytes + mu.nodeBytes + mu.heapBytes + mu.tombstoneBytes
+                + mu.filterBytes);
+}
+
+// Test 10: filters never reject a present key and reject most absent ones
+void testFilters() {
+    HashTable<int,int> ht(0.5);
+    ht.enableFilter(0.01);
+    for (int i = 0; i < 3000; i++) ht.insert({i, i});
+    for (int i = 0; i < 3000; i++) assert_true(ht.find(i) != nullptr, "filter must not hide keys");
+    for (int i = 3000; i < 13000; i++) assert_true(ht.find(i) == nullptr, "miss stays a miss");
+    auto st = ht.stats();
+    assert_true(st.filtered > 9500, "most misses answered by the filter");
+    ht.remove(5);
+    assert_true(ht.find(5) == nullptr, "removed key not found through filter");
+    ht.insert({5, 50});
+    assert_true(ht.at(5) == 50, "reinserted key found");
+
+    vector<uint64_t> keys;
+    for (uint64_t i = 0; i < 5000; i++) keys.push_back(i * 7919);
+    XorFilter<> xf(keys);
+    for (uint64_t k : keys) assert_true(xf.mayContain(k), "xor filter keeps every key");
+    int falsePos = 0;
+    for (uint64_t i = 0; i < 100000; i++) falsePos += xf.mayContain(i * 7919 + 1);
+    assert_true(falsePos < 1000, "xor filter false-positive rate near 1/256");
+    assert_true(!XorFilter<>().mayContain(1), "empty xor filter contains nothing");
+}
+
+// Test 11: CLOCK cache evicts unreferenced entries and stays bounded
+void testClockCache() {
+    ClockCache<string,int> cache(3);
+    cache.put("a", 1);
+    cache.put("b", 2);
+    cache.put("c", 3);
+    assert_true(cache.get("a") && *cache.get("a") == 1, "a cached");
+    cache.put("d", 4);
+    assert_true(cache.get("b") == nullptr, "unreferenced b evicted first");
+    assert_true(cache.get("a") && cache.get("c") && cache.get("d"), "others kept");
+    cache.put("c", 30);
+    assert_true(*cache.get("c") == 30, "put overwrites");
+    auto st = cache.stats();
+    assert_true(st.hits == 6 && st.misses == 1 && st.evictions == 1, "cache counters");
+
+    ClockCache<int,int> churn(100);
+    for (int i = 0; i < 100000; i++) {
+        if (!churn.get(i % 150)) churn.put(i % 150, i);
+    }
+    assert_true(churn.size() == 100, "cache holds capacity entries");
+    assert_true(churn.memoryUsage().slotBytes < 100 * 1024, "index does not grow with churn");
+}
+
+// Test 12: single-pass double hashing never runs the second hash
+struct CountingHash {
+    size_t* calls;
+    CountingHash(size_t* c = nullptr) : calls(c) {}
+    size_t operator()(const string& k) const { if (calls) ++*calls; return MyStringHash()(k); }
+};
+void testSinglePassDoubleHash() {
+    size_t h2Calls = 0;
+    typedef DoubleHashProber<string,CountingHash> DHP;
+    HashTable<string,int,DHP,MyStringHash> ht(0.5, DHP(CountingHash(&h2Calls), true));
+    for (int i = 0; i < 3000; i++) ht.insert({"w" + to_string(i), i});
+    for (int i = 0; i < 3000; i++) {
+        auto p = ht.find("w" + to_string(i));
+        assert_true(p && p->second == i, "single-pass keys found");
+    }
+    assert_true(ht.find("missing") == nullptr, "single-pass miss");
+    assert_true(h2Calls == 0, "second hash never computed");
+
+    HashTable<string,int,DHP,MyStringHash> two(0.5, DHP(CountingHash(&h2Calls)));
+    two.insert({"x", 1});
+    assert_true(h2Calls > 0 && two.at("x") == 1, "two-pass mode still uses h2");
+}
+
+// Test 13: case-insensitive keys share one entry
+void testCaseInsensitiveKeys() {
+    HashTable<string,int,LinearProber<string>,MyStringHash,MyStringEqual> ht(0.5);
+    ht.insert({"Apple", 1});
+    ht.insert({"APPLE", 2});
+    assert_true(ht.size() == 1, "case variants are one key");
+    assert_true(ht.at("aPPle") == 2, "lookup ignores case");
+    assert_true(ht.find("Apple")->first == "Apple", "first spelling kept without normalizer");
+
+    HashTable<string,int,LinearProber<string>,MyStringHash,MyStringEqual> norm(0.5);
+    norm.setNormalizer(&foldAsciiCase);
+    norm.insert({"BaNaNa", 1});
+    norm["BANANA"] += 4;
+    assert_true(norm.size() == 1 && norm.find("banana")->first == "banana", "stored key normalized");
+    assert_true(norm.at("Banana") == 5, "operator[] updates the normalized entry");
+}
+
+// Test 14: a recorded trace replays identically on another configuration
+void testTraceReplay() {
+    stringstream buf;
+    TraceRecorder<string> rec(buf);
+    HashTable<string,int> ht(0.5);
+    ht.setObserver(&rec);
+    for (int i = 0; i < 500; i++) ht.insert({"k" + to_string(i % 200), i});
+    for (int i = 0; i < 300; i++) ht.find("k" + to_string(i));
+    for (int i = 0; i < 100; i += 3) ht.remove("k" + to_string(i));
+    ht["k7"] += 1;
+    ht["new"] += 1;
+    size_t hits = 0;
+    for (int i = 0; i < 300; i++) hits += ht.find("k" + to_string(i)) != nullptr;
+    ht.setObserver(nullptr);
+    ht.find("untraced");
+    assert_true(rec.records() == 500 + 300 + 34 + 2 + 300, "every call recorded");
+    assert_true(rec.distinctKeys() == 301, "keys get one id each");
+
+    Trace<string> trace = readTrace<string>(buf);
+    assert_true(trace.ops.size() == rec.records() && trace.keys.size() == 301, "trace read back");
+    DoubleHashProber<string,MyStringHash> dhp;
+    HashTable<string,int,DoubleHashProber<string,MyStringHash>,MyStringHash> other(0.7, dhp);
+    size_t replayHits = replayTrace(trace, other);
+    assert_true(other.size() == ht.size(), "replay ends with the same size");
+    assert_true(replayHits == 200 + hits, "replay sees the same hits");
+}
+
+// Test 15: latency histograms count each call and log resize pauses
+void testLatencyRecorder() {
+    LatencyHistogram h;
+    for (uint64_t ns = 1; ns <= 10000; ns++) h.record(ns);
+    assert_true(h.count() == 10000 && h.max() == 10000, "histogram count and max");
+    uint64_t p50 = h.percentile(0.5), p99 = h.percentile(0.99);
+    assert_true(p50 >= 5000 && p50 <= 5000 * 1.04, "p50 within bucket precision");
+    assert_true(p99 >= 9900 && p99 <= 10000, "p99 within bucket precision");
+
+    HashLatency lat;
+    HashTable<int,int> ht(0.5);
+    ht.setLatencyRecorder(&lat);
+    for (int i = 0; i < 1000; i++) ht.insert({i, i});
+    for (int i = 0; i < 500; i++) ht.find(i);
+    for (int i = 0; i < 100; i++) ht.remove(i);
+    ht[5000] = 1;
+    assert_true(lat.histogram(OP_INSERT).count() == 1000, "inserts timed");
+    assert_true(lat.histogram(OP_FIND).count() == 500, "finds timed");
+    assert_true(lat.histogram(OP_REMOVE).count() == 100, "removes timed");
+    assert_true(lat.histogram(OP_INDEX).count() == 1, "operator[] timed");
+    assert_true(lat.histogram(OP_RESIZE).count() == ht.stats().resizes, "resizes timed");
+    auto pauses = lat.pauses();
+    assert_true(pauses.size() == ht.stats().resizes, "one pause per resize");
+    assert_true(pauses.back().newCapacity == ht.stats().capacity, "pause log capacities");
+    LatencyHistogram ins = lat.histogram(OP_INSERT);
+    assert_true(ins.percentile(0.5) <= ins.percentile(0.999) && ins.percentile(0.999) <= ins.max(),
+                "percentiles ordered");
+}
+
+// Test 16: a logged table recovers from its snapshot plus the log tail
+void testLoggedRecovery() {
+    char dir[] = "/tmp/ht-test-XXXXXX";
+    assert_true(mkdtemp(dir) != nullptr, "temp dir");
+    string path = string(dir) + "/words";
+    {
+        HashTable<string,int> ht(0.5);
+        LoggedTable<HashTable<string,int> > log(ht, path);
+        for (int i = 0; i < 1000; i++) log.insert({"w" + to_string(i), i});
+        log.snapshot();
+        assert_true(log.logRecords() == 0, "snapshot empties the log");
+        for (int i = 0; i < 100; i++) log.remove("w" + to_string(i));
+        log.insert({"w500", -1});
+        log.insert({"extra", 7});
+        log.sync();
+    }
+    {
+        HashTable<string,int> ht(0.5);
+        LoggedTable<HashTable<string,int> > log(ht, path);
+        assert_true(log.replayed() == 102, "only the tail is replayed");
+        assert_true(ht.size() == 901, "recovered size");
+        assert_true(!log.find("w5") && log.find("w500")->second == -1 && log.find("extra")->second == 7,
+                    "recovered contents");
+        assert_true(ht.stats().resizes == 1, "snapshot loaded with one resize");
+    }
+    // a torn final record is dropped and later appends still recover
+    {
+        ofstream torn((path + ".log").c_str(), ios::binary | ios::app);
+        torn.write("\x09\x00" "ab", 4);
+    }
+    {
+        HashTable<string,int> ht(0.5);
+        LoggedTable<HashTable<string,int> > log(ht, path, 50);
+        assert_true(log.replayed() == 102 && ht.size() == 901, "torn tail ignored");
+        for (int i = 0; i < 60; i++) log.insert({"more" + to_string(i), i});
+        assert_true(log.logRecords() == 9, "periodic snapshots taken");
+    }
+    {
+        HashTable<string,int> ht(0.5);
+        LoggedTable<HashTable<string,int> > log(ht, path);
+        assert_true(log.replayed() == 9 && ht.size() == 961, "recovered after periodic snapshot");
+    }
+    // a damaged length varint near 2^64 must not wrap the bounds check
+    {
+        ofstream torn((path + ".log").c_str(), ios::binary | ios::app);
+        string huge(9, '\xff');
+        huge += '\x01';
+        huge += "xyz";
+        torn.write(huge.data(), huge.size());
+    }
+    {
+        HashTable<string,int> ht(0.5);
+        LoggedTable<HashTable<string,int> > log(ht, path);
+        assert_true(log.replayed() == 9 && ht.size() == 961, "huge record length ignored");
+    }
+    unlink((path + ".log").c_str());
+    unlink((path + ".snap").c_str());
+    rmdir(dir);
+}
+
+// Test 17: pinned versions stay unchanged and edits copy only their chunks
+void testVersionedTable() {
+    typedef VersionedTable<string,int> VT;
+    VT vt(0.5);
+    for (int i = 0; i < 5000; i++) vt.insert({"w" + to_string(i), i});
+    VT::Snapshot v1 = vt.publish();
+    assert_true(vt.pin() == v1 && v1->size() == 5000, "first version published");
+
+    vt.insert({"w42", -42});
+    vt.remove("w7");
+    vt.insert({"fresh", 1});
+    assert_true(vt.copiedChunks() <= 3, "only touched chunks copied");
+    assert_true(vt.pin()->find("w42")->second == 42 && !vt.pin()->find("fresh"), "draft not visible");
+
+    VT::Snapshot v2 = vt.publish();
+    assert_true(v2->number() == v1->number() + 1, "version numbers advance");
+    assert_true(v2->find("w42")->second == -42 && !v2->find("w7") && v2->find("fresh"), "new version");
+    assert_true(v1->find("w42")->second == 42 && v1->find("w7") && !v1->find("fresh"), "pinned version unchanged");
+    assert_true(v2->size() == 5000 && v2->sharedChunks(*v1) + 3 >= v1->capacity() / VT::CHUNK_SLOTS,
+                "unmodified chunks shared");
+
+    // readers keep querying while a writer publishes new versions
+    atomic<bool> stop(false);
+    atomic<size_t> bad(0);
+    thread reader([&]() {
+        while (!stop.load()) {
+            VT::Snapshot v = vt.pin();
+            const pair<string,int>* p = v->find("w100");
+            if (!p || (p->second != 100 && p->second != int(v->number()))) ++bad;
+        }
+    });
+    for (int round = 0; round < 200; round++) {
+        uint64_t next = vt.pin()->number() + 1;
+        vt.insert({"w100", int(next)});
+        vt.insert({"r" + to_string(round), round});
+        vt.publish();
+    }
+    stop = true;
+    reader.join();
+    assert_true(bad == 0, "readers always see a consistent version");
+    assert_true(vt.pin()->size() == 5200, "final size");
+
+    // a pinned version outlives the table that published it
+    VT::Snapshot orphan;
+    {
+        VT gone(0.5);
+        gone.insert({"kept", 1});
+        orphan = gone.publish();
+    }
+    assert_true(orphan->find("kept") && orphan->find("kept")->second == 1 && !orphan->find("x"),
+                "snapshot usable after its table is destroyed");
+
+    // double hashing reaches every slot, even past 75% load
+    typedef VersionedTable<int,int,DoubleHashProber<int,std::hash<int> > > DVT;
+    DVT dh(0.95);
+    for (int i = 0; i < 1800; i++) dh.insert({i * 64, i});
+    DVT::Snapshot full = dh.publish();
+    bool all = true;
+    for (int i = 0; i < 1800; i++) all = all && full->find(i * 64) && full->find(i * 64)->second == i;
+    assert_true(full->size() > full->capacity() * 3 / 4 && all, "double hashing past 75% load");
+}
+
+// Test 18: bulk merge, intersect and difference, serial and parallel
+void testSetOperations() {
+    for (unsigned threads : {1u, 4u}) {
+        HashTable<int,int> a(0.5), b(0.5);
+        a.setResizeThreads(threads, 64);
+        for (int i = 0; i < 3000; i++) a.insert({i, i});
+        for (int i = 2000; i < 5000; i++) b.insert({i, -i});
+        b.enableFilter();
+
+        HashTable<int,int> u(0.5);
+        u.merge(a);
+        u.merge(b);
+        assert_true(u.size() == 5000, "union size");
+        assert_true(u.at(2500) == 2500 && u.at(4000) == -4000, "merge keeps existing values");
+
+        HashTable<int,int> d(0.5);
+        d.setResizeThreads(threads, 64);
+        d.merge(a);
+        d.difference(b);
+        assert_true(d.size() == 2000 && d.find(1999) && !d.find(2000), "difference");
+
+        a.intersect(b);
+        assert_true(a.size() == 1000 && a.find(2000) && a.find(2999) && !a.find(1999), "intersection");
+        assert_true(a.at(2500) == 2500, "intersection keeps this table's values");
+        a.insert({10, 10});
+        assert_true(a.size() == 1001 && a.stats().deleted <= 2000, "tombstones reused or purged");
+
+        a.difference(a);
+        assert_true(a.empty(), "difference with itself empties");
+    }
+
+    // merge stores keys in the destination's normalized form
+    typedef HashTable<string,int,LinearProber<string>,MyStringHash,MyStringEqual> CI;
+    CI src(0.5), dst(0.5);
+    src.insert({"Apple", 1});
+    src.insert({"PEAR", 2});
+    dst.setNormalizer(&foldAsciiCase);
+    dst.insert({"pear", 3});
+    dst.merge(src);
+    string keys;
+    dst.forEach([&keys](const pair<string,int>& it) { keys += it.first + ","; });
+    assert_true(dst.size() == 2 && dst.at("PEAR") == 3 && dst.at("apple") == 1, "merge into a folding table");
+    assert_true(keys == "apple,pear," || keys == "pear,apple,", "merged keys normalized");
+}
+
+// Test 19: increment/upsert probe once and multimap values stay grouped
+void testCountingAndMultimap() {
+    HashTable<string,int> counts(0.5);
+    const char* words[] = {"a", "b", "a", "c", "a", "b"};
+    for (const char* w : words) counts.increment(w, 1);
+    assert_true(counts.size() == 3 && counts.at("a") == 3 && counts.at("b") == 2, "increment counts");
+    assert_true(counts.increment("c", 10) == 11, "increment returns the new value");
+
+    // a hit costs the probes of a find; a miss one more probe sequence at most
+    size_t before = counts.stats().probes;
+    counts.increment("a", 1);
+    size_t hitProbes = counts.stats().probes - before;
+    before = counts.stats().probes;
+    counts.find("a");
+    assert_true(hitProbes == counts.stats().probes - before, "single probe on a hit");
+
+    counts.upsert("d", [](int& v) { v = v * 2 + 5; });
+    assert_true(counts.at("d") == 5, "upsert starts from a default value");
+    counts.remove("d");
+    counts.upsert("d", [](int& v) { v += 1; });
+    assert_true(counts.at("d") == 1 && counts.size() == 4, "upsert after remove");
+    for (int i = 0; i < 1000; i++) counts.increment("k" + to_string(i % 300), 1);
+    assert_true(counts.size() == 304 && counts.at("k7") == 4 && counts.at("k299") == 3,
+                "increment across resizes");
+
+    HashTable<string,int,LinearProber<string>,MyStringHash,MyStringEqual> ci(0.5);
+    ci.setNormalizer(&foldAsciiCase);
+    ci.enableFilter();
+    ci.increment("Word", 1);
+    ci.increment("WORD", 1);
+    assert_true(ci.size() == 1 && ci.at("word") == 2, "increment normalizes keys");
+
+    HashMultiMap<string,int> mm;
+    for (int i = 0; i < 500; i++) mm.add("k" + to_string(i % 50), i);
+    assert_true(mm.keys() == 50 && mm.size() == 500, "multimap sizes");
+    const vector<int>* vals = mm.values("k3");
+    assert_true(vals && vals->size() == 10 && (*vals)[0] == 3 && (*vals)[9] == 453, "values in insertion order");
+    mm.remove("k3");
+    assert_true(!mm.values("k3") && mm.count("k4") == 10 && mm.size() == 490, "multimap remove");
+}
+
+// Test 20: linear hashing grows and shrinks one bucket per operation
+void testLinearHashing() {
+    LinearHashTable<int,int> lh(1.0);
+    size_t buckets = lh.bucketCount();
+    for (int i = 0; i < 20000; i++) {
+        lh.insert({i * 7, i});
+        assert_true(lh.bucketCount() <= buckets + 1, "at most one split per insert");
+        buckets = lh.bucketCount();
+    }
+    LinearHashTable<int,int>::Stats st = lh.stats();
+    assert_true(st.size == 20000 && st.buckets >= 20000 && st.splits == st.buckets - 8, "splits track the load");
+    assert_true(st.segments == (st.buckets + 255) / 256, "segments follow the bucket count");
+    bool all = true;
+    for (int i = 0; i < 20000; i++) all = all && lh.find(i * 7) && lh.find(i * 7)->second == i;
+    assert_true(all && !lh.find(3), "every key found after splits");
+    lh.insert({14, -1});
+    assert_true(lh.size() == 20000 && lh.at(14) == -1, "insert overwrites");
+
+    for (int i = 0; i < 19990; i++) lh.remove(i * 7);
+    assert_true(lh.size() == 10 && lh.stats().merges > 0, "removes merge buckets back");
+    assert_true(lh.bucketCount() < 64 && lh.stats().segments == 1, "buckets and segments shrink");
+    all = true;
+    for (int i = 19990; i < 20000; i++) all = all && lh.at(i * 7) == i;
+    assert_true(all, "survivors found after merges");
+
+    // keys that differ only above the address bits still spread out
+    LinearHashTable<long,int> strided(1.0);
+    for (long i = 0; i < 20000; i++) strided.insert({i * 4096, int(i)});
+    all = true;
+    for (long i = 0; i < 20000; i++) all = all && strided.at(i * 4096) == i;
+    assert_true(all && strided.stats().longestChain <= 16, "strided keys spread over the buckets");
+
+    LinearHashTable<string,int,MyStringHash> counts(2.0);
+    for (int i = 0; i < 3000; i++) counts.increment("k" + to_string(i % 1000), 1);
+    counts["extra"] += 5;
+    int total = 0;
+    counts.forEach([&total](const pair<string,int>& it) { total += it.second; });
+    assert_true(counts.size() == 1001 && counts.at("k42") == 3 && total == 3005, "string counting");
+    bool threw = false;
+    try { counts.at("missing"); } catch (const out_of_range&) { threw = true; }
+    assert_true(threw, "at throws on a missing key");
+}
+
+// Test 21: a disk-backed table survives reopening and bulk loads in place
+void testDiskHashTable() {
+    char dir[] = "/tmp/ht-test-XXXXXX";
+    assert_true(mkdtemp(dir) != nullptr, "temp dir");
+    string path = string(dir) + "/keys", bulkPath = string(dir) + "/bulk";
+    typedef DiskHashTable<string,int> DT;
+    {
+        DT dt(path);
+        for (int i = 0; i < 20000; i++) dt.insert({"key" + to_string(i), i});
+        dt.insert({"key7", -7});
+        assert_true(dt.size() == 20000 && dt.find("key7")->second == -7, "insert overwrites");
+        DT::Stats st = dt.stats();
+        assert_true(st.splits > 0 && st.buckets == st.splits + DT::INITIAL_BUCKETS, "buckets split as it grows");
+        bool all = true;
+        for (int i = 0; i < 20000; i++) {
+            if (i == 7) continue;  // overwritten above
+            const pair<string,int>* it = dt.find("key" + to_string(i));
+            all = all && it && it->second == i;
+        }
+        assert_true(all, "every key found");
+        size_t reads = dt.stats().pageReads;
+        for (int i = 0; i < 20000; i++) assert_true(!dt.find("miss" + to_string(i)), "miss");
+        assert_true(dt.stats().pageReads - reads < 1000, "filter skips most misses");
+        for (int i = 0; i < 20000; i += 2) dt.remove("key" + to_string(i));
+        assert_true(dt.size() == 10000 && !dt.find("key2"), "removes");
+        dt.sync();
+    }
+    {
+        DT dt(path);
+        size_t count = 0;
+        dt.forEach([&count](const pair<string,int>&) { ++count; });
+        assert_true(dt.size() == 10000 && count == 10000, "reopened size");
+        assert_true(dt.find("key7")->second == -7 && dt.find("key19999")->second == 19999 && !dt.find("key4"),
+                    "reopened contents");
+        dt.insert({"after", 1});
+        assert_true(dt.find("after") && dt.size() == 10001, "inserts after reopening");
+        bool threw = false;
+        try { dt.insert({string(5000, 'x'), 1}); } catch (const length_error&) { threw = true; }
+        assert_true(threw && dt.size() == 10001, "oversized record rejected");
+    }
+    {
+        // a different hash would send lookups to the wrong buckets
+        int probe = open("/dev/null", O_RDONLY);
+        close(probe);
+        bool threw = false;
+        try { DiskHashTable<string,int,std::hash<string> > other(path); }
+        catch (const runtime_error&) { threw = true; }
+        assert_true(threw, "file rejected under another hash");
+        // stretch the first record of page 1 past its page's used bytes
+        int fd = open(path.c_str(), O_RDWR);
+        uint16_t len = 4000;
+        assert_true(pwrite(fd, &len, sizeof(len), DT::PAGE_SIZE + 16 + 8) == sizeof(len), "corrupt write");
+        close(fd);
+        threw = false;
+        try { DT dt(path); } catch (const runtime_error&) { threw = true; }
+        assert_true(threw, "overlong record rejected");
+        int after = open("/dev/null", O_RDONLY);
+        close(after);
+        assert_true(after == probe, "failed opens release their descriptor");
+    }
+    {
+        vector<pair<int,int> > items;
+        for (int i = 0; i < 50000; i++) items.push_back({i * 3, i});
+        DiskHashTable<int,int> dt(bulkPath);
+        dt.bulkLoad(items.begin(), items.end());
+        size_t splits = dt.stats().splits;
+        bool all = true;
+        for (int i = 0; i < 50000; i++) all = all && dt.find(i * 3) && dt.find(i * 3)->second == i;
+        assert_true(all && dt.size() == 50000 && !dt.find(1), "bulk-loaded contents");
+        size_t before = dt.stats().pageReads;
+        for (int i = 0; i < 1000; i++) dt.find(i * 3);
+        assert_true(dt.stats().pageReads - before < 1300, "about one page per hit");
+        dt.insert({1, 1});
+        assert_true(dt.stats().splits <= splits + 1, "bulk load left room to grow");
+    }
+    unlink(path.c_str());
+    unlink(bulkPath.c_str());
+    rmdir(dir);
+}
+
 int main() {
     TEST_CASE("Basic insert/find") testBasicInsertFind(); END_TEST();
     TEST_CASE("at() and operator[]") testAtAndOperatorBrackets(); END_TEST();
@@ -115,5 +667,20 @@ int main() {
     TEST_CASE("Resize and rehash") testResizeRehash(); END_TEST();
     TEST_CASE("Collision resolution (linear)") testCollisionResolution(); END_TEST();
     TEST_CASE("Double-hash probing") testDoubleHashProber(); END_TEST();
+    TEST_CASE("Parallel resize") testParallelResize(); END_TEST();
+    TEST_CASE("Stats and page backing") testStatsBacking(); END_TEST();
+    TEST_CASE("Memory usage") testMemoryUsage(); END_TEST();
+    TEST_CASE("Lookup filters") testFilters(); END_TEST();
+    TEST_CASE("CLOCK cache") testClockCache(); END_TEST();
+    TEST_CASE("Single-pass double hashing") testSinglePassDoubleHash(); END_TEST();
+    TEST_CASE("Case-insensitive keys") testCaseInsensitiveKeys(); END_TEST();
+    TEST_CASE("Trace record and replay") testTraceReplay(); END_TEST();
+    TEST_CASE("Latency recorder") testLatencyRecorder(); END_TEST();
+    TEST_CASE("Logged table recovery") testLoggedRecovery(); END_TEST();
+    TEST_CASE("Versioned table") testVersionedTable(); END_TEST();
+    TEST_CASE("Set operations") testSetOperations(); END_TEST();
+    TEST_CASE("Counting and multimap") testCountingAndMultimap(); END_TEST();
+    TEST_CASE("Linear hashing") testLinearHashing(); END_TEST();
+    TEST_CASE("Disk-backed table") testDiskHashTable(); END_TEST();
     return 0;
 }
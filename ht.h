@@ -6,7 +6,14 @@
 #include <stdexcept>
 #include <utility>
 #include <cstddef>
+#include <algorithm>
 #include <iostream>
+#include <thread>
+#include <memory>
+
+#include "alloc.h"
+#include "filter.h"
+#include "latency.h"
 
 // basic index type
 typedef std::size_t HASH_INDEX_T;
@@ -18,6 +25,8 @@ typedef std::size_t HASH_INDEX_T;
 template<typename KeyType>
 struct Prober {
     static const HASH_INDEX_T npos = static_cast<HASH_INDEX_T>(-1);
+    // probers that set this are started with initHashed() and the full hash
+    static const bool TAKES_FULL_HASH = false;
     HASH_INDEX_T start_;
     HASH_INDEX_T m_;
     size_t numProbes_;
@@ -27,6 +36,9 @@ struct Prober {
         m_ = m;
         numProbes_ = 0;
     }
+    void initHashed(HASH_INDEX_T hv, HASH_INDEX_T m, const KeyType& key) {
+        init(hv % m, m, key);
+    }
     HASH_INDEX_T next() {
         throw std::logic_error("Prober::next() must be overridden");
     }
@@ -42,19 +54,37 @@ struct LinearProber : public Prober<KeyType> {
     }
 };
 
+// With singlePass set, the step is taken from a remix of the table's own
+// hash instead of a second h2_(key) pass over the key.
 template<typename KeyType, typename Hash2>
 struct DoubleHashProber : public Prober<KeyType> {
+    static const bool TAKES_FULL_HASH = true;
     Hash2 h2_;
     HASH_INDEX_T dhstep_;
+    bool singlePass_;
+    HASH_INDEX_T cachedM_;
+    HASH_INDEX_T mod_;
     static const HASH_INDEX_T MODS[];
     static const int MODS_COUNT;
-    DoubleHashProber(const Hash2& h2 = Hash2()) : h2_(h2) {}
+    DoubleHashProber(const Hash2& h2 = Hash2(), bool singlePass = false)
+      : h2_(h2), singlePass_(singlePass), cachedM_(0), mod_(MODS[0]) {}
     void init(HASH_INDEX_T start, HASH_INDEX_T m, const KeyType& key) {
         Prober<KeyType>::init(start, m, key);
-        // find largest modulus < m
-        HASH_INDEX_T mod = MODS[0];
-        for (int i = 0; i < MODS_COUNT && MODS[i] < m; ++i) mod = MODS[i];
-        dhstep_ = mod - (h2_(key) % mod);
+        updateMod(m);
+        dhstep_ = mod_ - (h2_(key) % mod_);
+    }
+    void initHashed(HASH_INDEX_T hv, HASH_INDEX_T m, const KeyType& key) {
+        if (!singlePass_) { init(hv % m, m, key); return; }
+        Prober<KeyType>::init(hv % m, m, key);
+        updateMod(m);
+        dhstep_ = mod_ - (mixHash(hv) % mod_);
+    }
+    // find largest modulus < m, only when the capacity changed
+    void updateMod(HASH_INDEX_T m) {
+        if (m == cachedM_) return;
+        cachedM_ = m;
+        mod_ = MODS[0];
+        for (int i = 0; i < MODS_COUNT && MODS[i] < m; ++i) mod_ = MODS[i];
     }
     HASH_INDEX_T next() {
         if (this->numProbes_ >= this->m_) return this->npos;
@@ -75,6 +105,27 @@ const HASH_INDEX_T DoubleHashProber<KeyType,Hash2>::MODS[] = {
 template<typename KeyType, typename Hash2>
 const int DoubleHashProber<KeyType,Hash2>::MODS_COUNT = sizeof(DoubleHashProber<KeyType,Hash2>::MODS)/sizeof(HASH_INDEX_T);
 
+// -----------------------------------------------------------------------------
+// Operation hooks
+// -----------------------------------------------------------------------------
+
+// public HashTable operations, as seen by observers; OP_RESIZE is only
+// timed by a latency recorder
+enum HashOp { OP_INSERT, OP_FIND, OP_REMOVE, OP_INDEX, OP_RESIZE, OP_COUNT };
+
+static const char* const HASH_OP_NAMES[OP_COUNT] = {
+    "insert", "find", "remove", "operator[]", "resize"
+};
+
+typedef LatencyRecorder<OP_COUNT> HashLatency;
+
+// receives each public operation of a HashTable it is attached to
+template<typename KeyType>
+struct OpObserver {
+    virtual ~OpObserver() {}
+    virtual void onOp(HashOp op, const KeyType& key) = 0;
+};
+
 // -----------------------------------------------------------------------------
 // HashTable with open addressing
 // -----------------------------------------------------------------------------
@@ -92,14 +143,31 @@ public:
     typedef V ValueType;
     typedef std::pair<KeyType,ValueType> ItemType;
     struct HashItem { ItemType item; bool deleted; HashItem(const ItemType& it): item(it), deleted(false){} };
+    typedef std::vector<HashItem*, HugePageAllocator<HashItem*> > SlotArray;
+    typedef void (*Normalizer)(KeyType&);
+
+    struct Stats {
+        size_t size;          // live elements
+        size_t deleted;       // tombstones
+        size_t capacity;      // slots
+        size_t probes;        // probe steps since construction
+        size_t resizes;
+        size_t filtered;      // lookups answered by the filter without probing
+        PageBacking backing;  // pages requested for the slot array
+    };
 
     // species default threshold = 1.0 (no auto-resize)
     HashTable(double resizeAlpha = 0.4,
               const Prober& prober = Prober(),
               const Hash& hash = Hash(),
               const KEqual& kequal = KEqual())
-      : hash_(hash), kequal_(kequal), prober_(prober),
-        resizeAlpha_(resizeAlpha), elementCount_(0), deletedCount_(0), mIndex_(0)
+      : table_(HugePageAllocator<HashItem*>(&backing_)),
+        hash_(hash), kequal_(kequal), prober_(prober), totalProbes_(0),
+        resizeAlpha_(resizeAlpha), elementCount_(0), deletedCount_(0), mIndex_(0),
+        resizeThreads_(1),
+        parallelResizeMin_(PARALLEL_RESIZE_MIN), resizes_(0), backing_(PAGES_SMALL),
+        filterFpRate_(0.0), filtered_(0), normalize_(nullptr), observer_(nullptr),
+        latency_(nullptr)
     {
         table_.assign(CAPACITIES[mIndex_], nullptr);
     }
@@ -108,48 +176,94 @@ public:
         for (auto ptr : table_) delete ptr;
     }
 
+    // old tables with fewer than PARALLEL_RESIZE_MIN slots rehash serially
+    static const size_t PARALLEL_RESIZE_MIN = 1 << 17;
+
+    // Number of threads used to rehash large tables (0 or 1 = serial, the
+    // default). Opt in only for big tables: small ones inside caches
+    // would otherwise start a thread per core on every large resize.
+    void setResizeThreads(unsigned threads, size_t minSlots = PARALLEL_RESIZE_MIN) {
+        resizeThreads_ = threads;
+        parallelResizeMin_ = minSlots;
+    }
+
+    // Grow once so n elements fit under the resize threshold, instead of
+    // rehashing through every intermediate capacity during a bulk load.
+    void reserve(size_t n) {
+        size_t index = mIndex_;
+        while (index + 1 < CAPACITY_COUNT && double(n) / CAPACITIES[index] >= resizeAlpha_) ++index;
+        if (index != mIndex_) rehashTo(index);
+    }
+
+    // Keep a Bloom filter of inserted keys in front of lookups so most misses
+    // never probe the table. Removed keys stay in the filter until the next
+    // resize rebuilds it; fpRate of 0 detaches the filter.
+    void enableFilter(double fpRate = 0.01) {
+        filterFpRate_ = fpRate;
+        rebuildFilter();
+    }
+
+    // Rewrite keys into a canonical form before they are stored, e.g.
+    // foldAsciiCase with MyStringEqual. KEqual must treat a key and its
+    // normalized form as equal so lookups still find it.
+    void setNormalizer(Normalizer normalize) { normalize_ = normalize; }
+
+    // report every insert/find/remove/operator[] call to observer (nullptr detaches)
+    void setObserver(OpObserver<KeyType>* observer) { observer_ = observer; }
+
+    // time every operation and resize into latency (nullptr detaches)
+    void setLatencyRecorder(HashLatency* latency) { latency_ = latency; }
+
     bool empty() const { return elementCount_ == 0; }
     size_t size() const { return elementCount_; }
 
+    Stats stats() const {
+        Stats s;
+        s.size = elementCount_;
+        s.deleted = deletedCount_;
+        s.capacity = table_.size();
+        s.probes = totalProbes_;
+        s.resizes = resizes_;
+        s.filtered = filtered_;
+        s.backing = backing_;
+        return s;
+    }
+
+    // bytes used by slots, item nodes, key/value heap buffers and tombstones
+    MemoryUsage memoryUsage() const {
+        MemoryUsage mu;
+        mu.slotBytes = allocatedBytes(table_.capacity() * sizeof(HashItem*));
+        if (filter_) mu.filterBytes = filter_->bytes();
+        for (auto ptr : table_) {
+            if (!ptr) continue;
+            size_t heap = heapBytes(ptr->item.first) + heapBytes(ptr->item.second);
+            if (ptr->deleted) {
+                mu.tombstoneBytes += sizeof(HashItem) + heap;
+            } else {
+                mu.nodeBytes += sizeof(HashItem);
+                mu.heapBytes += heap;
+            }
+        }
+        return mu;
+    }
+
     // expose table_ for testing
-    std::vector<HashItem*> table_;
+    SlotArray table_;
 
     // expose probe for testing
     HASH_INDEX_T probe(const KeyType& key) const {
-        HASH_INDEX_T h = hash_(key) % CAPACITIES[mIndex_];
-        prober_.init(h, CAPACITIES[mIndex_], key);
-        HASH_INDEX_T loc = prober_.next(); ++totalProbes_;
-        while (loc != Prober::npos) {
-            // Stop at empty slot, deleted slot, or matching key
-            if (!table_[loc] || (!table_[loc]->deleted && kequal_(table_[loc]->item.first, key)))
-                return loc;
-            loc = prober_.next(); ++totalProbes_;
-        }
-        return Prober::npos;
+        return probeFrom(hash_(key), key);
     }
 
     void insert(const ItemType& p) {
-        // consider tombstones in load factor
-        double lf = double(elementCount_ + deletedCount_) / CAPACITIES[mIndex_];
-        if (lf >= resizeAlpha_) resize();
-
-        HASH_INDEX_T loc = probe(p.first);
-        if (loc == Prober::npos) throw std::logic_error("HashTable full");
-
-        if (!table_[loc]) {
-            table_[loc] = new HashItem(p);
-            ++elementCount_;
-        } else if (table_[loc]->deleted) {
-            table_[loc]->item = p;
-            table_[loc]->deleted = false;
-            ++elementCount_;
-            --deletedCount_;
-        } else {
-            table_[loc]->item.second = p.second;
-        }
+        LatencyTimer<HashLatency> timer(latency_, OP_INSERT);
+        if (observer_) observer_->onOp(OP_INSERT, p.first);
+        insertNormalized(p);
     }
 
     void remove(const KeyType& key) {
+        LatencyTimer<HashLatency> timer(latency_, OP_REMOVE);
+        if (observer_) observer_->onOp(OP_REMOVE, key);
         HashItem* hi = internalFind(key);
         if (hi && !hi->deleted) {
             hi->deleted = true;
@@ -159,20 +273,28 @@ public:
     }
 
     ItemType* find(const KeyType& key) {
+        LatencyTimer<HashLatency> timer(latency_, OP_FIND);
+        if (observer_) observer_->onOp(OP_FIND, key);
         auto hi = internalFind(key);
         return hi ? &hi->item : nullptr;
     }
     const ItemType* find(const KeyType& key) const {
+        LatencyTimer<HashLatency> timer(latency_, OP_FIND);
+        if (observer_) observer_->onOp(OP_FIND, key);
         auto hi = internalFind(key);
         return hi ? &hi->item : nullptr;
     }
 
     ValueType& at(const KeyType& key) {
+        LatencyTimer<HashLatency> timer(latency_, OP_FIND);
+        if (observer_) observer_->onOp(OP_FIND, key);
         auto hi = internalFind(key);
         if (!hi) throw std::out_of_range("Bad key");
         return hi->item.second;
     }
     const ValueType& at(const KeyType& key) const {
+        LatencyTimer<HashLatency> timer(latency_, OP_FIND);
+        if (observer_) observer_->onOp(OP_FIND, key);
         auto hi = internalFind(key);
         if (!hi) throw std::out_of_range("Bad key");
         return hi->item.second;
@@ -180,15 +302,81 @@ public:
 
     // non-const operator[]: insert if missing
     ValueType& operator[](const KeyType& key) {
-        HashItem* hi = internalFind(key);
-        if (!hi) {
-            insert({key, ValueType()});
-            hi = internalFind(key);
-        }
-        return hi->item.second;
+        LatencyTimer<HashLatency> timer(latency_, OP_INDEX);
+        if (observer_) observer_->onOp(OP_INDEX, key);
+        return findOrInsert(key)->item.second;
+    }
+
+    // add delta to key's value (starting from ValueType()) with one probe
+    // sequence; returns the new value. Observed and timed as operator[].
+    ValueType& increment(const KeyType& key, const ValueType& delta) {
+        LatencyTimer<HashLatency> timer(latency_, OP_INDEX);
+        if (observer_) observer_->onOp(OP_INDEX, key);
+        ValueType& v = findOrInsert(key)->item.second;
+        v += delta;
+        return v;
+    }
+
+    // call fn(value&) on key's value, default-constructing it first if the
+    // key is missing, with one probe sequence
+    template<typename F>
+    ValueType& upsert(const KeyType& key, F fn) {
+        LatencyTimer<HashLatency> timer(latency_, OP_INDEX);
+        if (observer_) observer_->onOp(OP_INDEX, key);
+        ValueType& v = findOrInsert(key)->item.second;
+        fn(v);
+        return v;
     }
     const ValueType& operator[](const KeyType& key) const { return at(key); }
 
+    // -------------------------------------------------------------------------
+    // Bulk set operations. Each walks one table's slot array in order and
+    // hashes every key once, using that value for the other table's filter
+    // and probe sequence. They are not reported to observers or timed.
+    // -------------------------------------------------------------------------
+
+    // union: copy in the items of other whose keys are missing here
+    // (existing keys keep their values). Keys go through this table's
+    // normalizer as insert() does. Unlike intersect/difference this stays
+    // serial on purpose: it inserts, and inserts into one slot array would
+    // race for the same empty slots.
+    void merge(const HashTable& other) {
+        if (&other == this) return;
+        reserve(elementCount_ + other.elementCount_);
+        Prober prober(prober_);
+        for (auto ptr : other.table_) {
+            if (!ptr || ptr->deleted) continue;
+            if (normalize_) {
+                ItemType item(ptr->item);
+                normalize_(item.first);
+                HASH_INDEX_T hv = hash_(item.first);
+                if (!lookupHashed(prober, hv, item.first, totalProbes_)) insertHashed(hv, item);
+                continue;
+            }
+            HASH_INDEX_T hv = hash_(ptr->item.first);
+            if (!lookupHashed(prober, hv, ptr->item.first, totalProbes_))
+                insertHashed(hv, ptr->item);
+        }
+    }
+
+    // keep only the keys also present in other
+    void intersect(const HashTable& other) {
+        if (&other == this) return;
+        removeWhere(other, false);
+    }
+
+    // remove the keys present in other
+    void difference(const HashTable& other) {
+        removeWhere(other, true);
+    }
+
+    // call f(item) for every live item, in slot order
+    template<typename F>
+    void forEach(F f) const {
+        for (auto ptr : table_)
+            if (ptr && !ptr->deleted) f(static_cast<const ItemType&>(ptr->item));
+    }
+
     void reportAll(std::ostream& out) const {
         for (size_t i = 0; i < table_.size(); ++i) {
             if (table_[i] && !table_[i]->deleted)
@@ -198,9 +386,97 @@ public:
     }
 
 private:
+    void insertNormalized(const ItemType& p) {
+        if (normalize_) {
+            ItemType q(p);
+            normalize_(q.first);
+            insertItem(q);
+        } else {
+            insertItem(p);
+        }
+    }
+
+    HashItem* findOrInsert(const KeyType& key) {
+        if (!normalize_) return findOrInsertItem(key);
+        KeyType k(key);
+        normalize_(k);
+        return findOrInsertItem(k);
+    }
+
+    // The probe that finds key also yields the empty slot it would go in,
+    // so a miss inserts there unless the table has to grow first.
+    HashItem* findOrInsertItem(const KeyType& key) {
+        HASH_INDEX_T hv = hash_(key);
+        HASH_INDEX_T loc = Prober::npos;
+        if (filter_ && !filter_->mayContain(hv)) {
+            ++filtered_;
+        } else {
+            loc = probeFrom(hv, key);
+            if (loc != Prober::npos && table_[loc]) return table_[loc];
+        }
+        double lf = double(elementCount_ + deletedCount_) / CAPACITIES[mIndex_];
+        if (lf >= resizeAlpha_) {
+            resize(double(elementCount_) / CAPACITIES[mIndex_] >= resizeAlpha_ / 2);
+            loc = Prober::npos;
+        }
+        if (loc == Prober::npos) loc = probeFrom(hv, key);
+        if (loc == Prober::npos) throw std::logic_error("HashTable full");
+        if (filter_) filter_->add(hv);
+        table_[loc] = new HashItem(ItemType(key, ValueType()));
+        ++elementCount_;
+        return table_[loc];
+    }
+
+    void insertItem(const ItemType& p) {
+        insertHashed(hash_(p.first), p);
+    }
+
+    void insertHashed(HASH_INDEX_T hv, const ItemType& p) {
+        // consider tombstones in load factor
+        double lf = double(elementCount_ + deletedCount_) / CAPACITIES[mIndex_];
+        if (lf >= resizeAlpha_) {
+            // when tombstones make up most of the load, purge them in place
+            resize(double(elementCount_) / CAPACITIES[mIndex_] >= resizeAlpha_ / 2);
+        }
+
+        HASH_INDEX_T loc = probeFrom(hv, p.first);
+        if (loc == Prober::npos) throw std::logic_error("HashTable full");
+        if (filter_) filter_->add(hv);
+
+        if (!table_[loc]) {
+            table_[loc] = new HashItem(p);
+            ++elementCount_;
+        } else if (table_[loc]->deleted) {
+            table_[loc]->item = p;
+            table_[loc]->deleted = false;
+            ++elementCount_;
+            --deletedCount_;
+        } else {
+            table_[loc]->item.second = p.second;
+        }
+    }
+
+    void initProber(Prober& prober, HASH_INDEX_T hv, HASH_INDEX_T m, const KeyType& key) const {
+        if (Prober::TAKES_FULL_HASH) prober.initHashed(hv, m, key);
+        else prober.init(hv % m, m, key);
+    }
+
+    HASH_INDEX_T probeFrom(HASH_INDEX_T hv, const KeyType& key) const {
+        initProber(prober_, hv, CAPACITIES[mIndex_], key);
+        HASH_INDEX_T loc = prober_.next(); ++totalProbes_;
+        while (loc != Prober::npos) {
+            // Stop at empty slot, deleted slot, or matching key
+            if (!table_[loc] || (!table_[loc]->deleted && kequal_(table_[loc]->item.first, key)))
+                return loc;
+            loc = prober_.next(); ++totalProbes_;
+        }
+        return Prober::npos;
+    }
+
     HashItem* internalFind(const KeyType& key) const {
-        HASH_INDEX_T h = hash_(key) % CAPACITIES[mIndex_];
-        prober_.init(h, CAPACITIES[mIndex_], key);
+        HASH_INDEX_T hv = hash_(key);
+        if (filter_ && !filter_->mayContain(hv)) { ++filtered_; return nullptr; }
+        initProber(prober_, hv, CAPACITIES[mIndex_], key);
         HASH_INDEX_T loc = prober_.next(); ++totalProbes_;
         while (loc != Prober::npos) {
             if (!table_[loc]) return nullptr;
@@ -211,14 +487,72 @@ private:
         return nullptr;
     }
 
-    void resize() {
-        if (mIndex_ + 1 >= (sizeof(CAPACITIES)/sizeof(CAPACITIES[0])))
+    // Lookup with a caller-owned prober and probe counter, so several
+    // threads can search one table at once. Skips the filter counter.
+    HashItem* lookupHashed(Prober& prober, HASH_INDEX_T hv, const KeyType& key, size_t& probes) const {
+        if (filter_ && !filter_->mayContain(hv)) return nullptr;
+        initProber(prober, hv, CAPACITIES[mIndex_], key);
+        for (HASH_INDEX_T loc = prober.next(); loc != Prober::npos; loc = prober.next()) {
+            ++probes;
+            HashItem* hi = table_[loc];
+            if (!hi) return nullptr;
+            if (!hi->deleted && kequal_(hi->item.first, key)) return hi;
+        }
+        return nullptr;
+    }
+
+    // Tombstone every live item whose key is (inPresent) or is not
+    // (!inPresent) found in other. Large tables are split into one slot
+    // range per resize thread; each range only marks its own slots.
+    void removeWhere(const HashTable& other, bool inPresent) {
+        size_t threads = (resizeThreads_ > 1 && table_.size() >= parallelResizeMin_) ? resizeThreads_ : 1;
+        size_t chunk = (table_.size() + threads - 1) / threads;
+        std::vector<size_t> removed(threads, 0), probes(threads, 0);
+        auto scan = [this, &other, inPresent, chunk, &removed, &probes](size_t t) {
+            Prober prober(other.prober_);
+            size_t end = std::min(table_.size(), (t + 1) * chunk);
+            for (size_t i = t * chunk; i < end; ++i) {
+                HashItem* hi = table_[i];
+                if (!hi || hi->deleted) continue;
+                const KeyType& key = hi->item.first;
+                bool found = &other == this ||
+                    other.lookupHashed(prober, other.hash_(key), key, probes[t]) != nullptr;
+                if (found == inPresent) {
+                    hi->deleted = true;
+                    ++removed[t];
+                }
+            }
+        };
+        if (threads == 1) scan(0);
+        else runParallel(threads, scan);
+        for (size_t t = 0; t < threads; ++t) {
+            elementCount_ -= removed[t];
+            deletedCount_ += removed[t];
+            totalProbes_ += probes[t];
+        }
+    }
+
+    // rehash into the next capacity, or into the same one when !grow
+    void resize(bool grow = true) {
+        if (grow && mIndex_ + 1 >= CAPACITY_COUNT)
             throw std::logic_error("No more primes to grow to");
+        rehashTo(mIndex_ + (grow ? 1 : 0));
+    }
+
+    // rehash every live item into CAPACITIES[index]
+    void rehashTo(size_t index) {
+        PauseTimer pause(latency_, CAPACITIES[mIndex_], CAPACITIES[index]);
         auto old = std::move(table_);
-        ++mIndex_;
+        mIndex_ = index;
+        ++resizes_;
         table_.assign(CAPACITIES[mIndex_], nullptr);
         elementCount_ = 0;
         deletedCount_ = 0;
+        if (resizeThreads_ > 1 && old.size() >= parallelResizeMin_) {
+            parallelRehash(old);
+            rebuildFilter();
+            return;
+        }
         for (auto ptr : old) {
             if (ptr && !ptr->deleted) {
                 HASH_INDEX_T loc = probe(ptr->item.first);
@@ -228,6 +562,87 @@ private:
                 delete ptr;
             }
         }
+        rebuildFilter();
+    }
+
+    // times a resize and adds it to the pause log
+    struct PauseTimer : LatencyTimer<HashLatency> {
+        HashLatency* rec_;
+        size_t oldCap_, newCap_;
+        PauseTimer(HashLatency* rec, size_t oldCap, size_t newCap)
+          : LatencyTimer<HashLatency>(rec, OP_RESIZE), rec_(rec), oldCap_(oldCap), newCap_(newCap) {}
+        ~PauseTimer() { if (rec_) rec_->recordPause(start(), elapsedNs(), oldCap_, newCap_); }
+    };
+
+    // size the filter for the current resize threshold and refill it
+    void rebuildFilter() {
+        if (filterFpRate_ <= 0.0) { filter_.reset(); return; }
+        size_t expected = size_t(table_.size() * std::min(resizeAlpha_, 1.0));
+        if (!filter_) filter_.reset(new BloomFilter(std::max(expected, elementCount_), filterFpRate_));
+        else filter_->reset(std::max(expected, elementCount_), filterFpRate_);
+        for (auto ptr : table_)
+            if (ptr && !ptr->deleted) filter_->add(hash_(ptr->item.first));
+    }
+
+    // split old into one range per thread and rehash the ranges concurrently
+    void parallelRehash(SlotArray& old) {
+        size_t threads = resizeThreads_;
+        size_t chunk = (old.size() + threads - 1) / threads;
+        std::vector<size_t> moved(threads, 0);
+        runParallel(threads, [this, &old, &moved, chunk](size_t t) {
+            size_t begin = std::min(old.size(), t * chunk);
+            size_t end = std::min(old.size(), begin + chunk);
+            moved[t] = rehashRange(old, begin, end);
+        });
+        for (size_t t = 0; t < threads; ++t) elementCount_ += moved[t];
+    }
+
+    // Run job(0) .. job(threads-1) on their own threads. Jobs whose thread
+    // cannot be started run on the calling thread instead, and every
+    // started thread is joined before returning or rethrowing.
+    template<typename Job>
+    static void runParallel(size_t threads, Job job) {
+        std::vector<std::thread> workers;
+        size_t started = 0;
+        try {
+            workers.reserve(threads);
+            for (; started < threads; ++started) workers.emplace_back(job, started);
+        } catch (...) {
+            // out of threads: the jobs not started run below
+        }
+        try {
+            for (size_t t = started; t < threads; ++t) job(t);
+        } catch (...) {
+            for (auto& w : workers) w.join();
+            throw;
+        }
+        for (auto& w : workers) w.join();
+    }
+
+    // Reinsert live items of old[begin,end) into table_. Empty slots are
+    // claimed with a compare-and-swap so two threads never place items in
+    // the same slot. Nothing is freed while rehashing, so each item still
+    // lands on its own probe sequence behind slots that stay occupied.
+    size_t rehashRange(SlotArray& old, size_t begin, size_t end) {
+        Prober prober(prober_);
+        HASH_INDEX_T m = table_.size();
+        size_t moved = 0;
+        for (size_t i = begin; i < end; ++i) {
+            HashItem* ptr = old[i];
+            if (!ptr) continue;
+            if (ptr->deleted) { delete ptr; continue; }
+            const KeyType& key = ptr->item.first;
+            initProber(prober, hash_(key), m, key);
+            for (HASH_INDEX_T loc = prober.next(); loc != Prober::npos; loc = prober.next()) {
+                HashItem* expected = nullptr;
+                if (!__atomic_load_n(&table_[loc], __ATOMIC_RELAXED) &&
+                    __atomic_compare_exchange_n(&table_[loc], &expected, ptr, false,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                    break;
+            }
+            ++moved;
+        }
+        return moved;
     }
 
     Hash hash_;
@@ -238,8 +653,19 @@ private:
     size_t elementCount_;
     size_t deletedCount_;
     size_t mIndex_;
+    unsigned resizeThreads_;
+    size_t parallelResizeMin_;
+    size_t resizes_;
+    PageBacking backing_;
+    std::unique_ptr<BloomFilter> filter_;
+    double filterFpRate_;
+    mutable size_t filtered_;
+    Normalizer normalize_;
+    OpObserver<KeyType>* observer_;
+    HashLatency* latency_;
 
     static const HASH_INDEX_T CAPACITIES[];
+    static const size_t CAPACITY_COUNT;
 };
 
 // static table sizes
@@ -252,5 +678,8 @@ const HASH_INDEX_T HashTable<K,V,Prober,Hash,KEqual>::CAPACITIES[] = {
     105359969,210719881,421439783,842879579,
     1685759113
 };
+template<typename K, typename V, typename Prober, typename Hash, typename KEqual>
+const size_t HashTable<K,V,Prober,Hash,KEqual>::CAPACITY_COUNT =
+    sizeof(HashTable<K,V,Prober,Hash,KEqual>::CAPACITIES) / sizeof(HASH_INDEX_T);
 
 #endif // HT_H
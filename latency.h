@@ -0,0 +1,195 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "alloc.h"
+
+// -----------------------------------------------------------------------------
+// Latency recording
+// -----------------------------------------------------------------------------
+
+// Log-linear (HDR style) histogram of nanosecond latencies: each power of
+// two is split into 32 sub-buckets, so any reported value is within ~3% of
+// the recorded one. Values of 2^36 ns (~68 s) and above share the last bucket.
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int MAX_EXP = 35;
+    static const int BUCKETS = (MAX_EXP - SUB_BITS + 2) * SUB_COUNT;
+
+    LatencyHistogram() : counts_(BUCKETS, 0), total_(0), max_(0) {}
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < uint64_t(SUB_COUNT)) return int(ns);
+        int exp = 63 - __builtin_clzll(ns);
+        if (exp > MAX_EXP) return BUCKETS - 1;
+        int sub = int(ns >> (exp - SUB_BITS)) & (SUB_COUNT - 1);
+        return (exp - SUB_BITS + 1) * SUB_COUNT + sub;
+    }
+
+    // largest value that falls into bucket b
+    static uint64_t bucketHigh(int b) {
+        if (b < SUB_COUNT) return uint64_t(b);
+        int exp = b / SUB_COUNT + SUB_BITS - 1;
+        uint64_t sub = uint64_t(b % SUB_COUNT);
+        return ((uint64_t(SUB_COUNT) + sub + 1) << (exp - SUB_BITS)) - 1;
+    }
+
+    void record(uint64_t ns) { add(bucketOf(ns), 1, ns); }
+
+    void add(int bucket, uint64_t count, uint64_t maxNs) {
+        counts_[bucket] += count;
+        total_ += count;
+        if (maxNs > max_) max_ = maxNs;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t max() const { return max_; }
+
+    // smallest recorded-bucket bound covering fraction p of all samples
+    uint64_t percentile(double p) const {
+        if (total_ == 0) return 0;
+        uint64_t rank = uint64_t(p * double(total_) + 0.5);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts_[b];
+            if (seen >= rank) return bucketHigh(b) < max_ ? bucketHigh(b) : max_;
+        }
+        return max_;
+    }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t max_;
+};
+
+// one resize: when it started (ns since the recorder was created), how long
+// it paused the caller and the capacities it moved between
+struct ResizePause {
+    uint64_t startNs;
+    uint64_t ns;
+    std::size_t oldCapacity;
+    std::size_t newCapacity;
+};
+
+// Latency histograms for NumOps operation kinds. Threads are spread over
+// SHARDS cache-line separated bucket sets by thread id and count with
+// relaxed atomics, so concurrent readers rarely share a line.
+template<int NumOps>
+class LatencyRecorder {
+public:
+    static const int SHARDS = 8;
+    typedef std::chrono::steady_clock Clock;
+
+    LatencyRecorder() : shards_(SHARDS), created_(Clock::now()) {}
+
+    void record(int op, uint64_t ns) {
+        Shard& s = shards_[shardIndex()];
+        s.counts[op][LatencyHistogram::bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t prev = s.max[op].load(std::memory_order_relaxed);
+        while (ns > prev && !s.max[op].compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+    }
+
+    void recordPause(Clock::time_point start, uint64_t ns, std::size_t oldCap, std::size_t newCap) {
+        ResizePause p;
+        p.startNs = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(start - created_).count());
+        p.ns = ns;
+        p.oldCapacity = oldCap;
+        p.newCapacity = newCap;
+        std::lock_guard<std::mutex> lock(pauseLock_);
+        pauses_.push_back(p);
+    }
+
+    // all shards of one operation merged
+    LatencyHistogram histogram(int op) const {
+        LatencyHistogram h;
+        for (const Shard& s : shards_) {
+            for (int b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+                uint64_t c = s.counts[op][b].load(std::memory_order_relaxed);
+                if (c) h.add(b, c, 0);
+            }
+            h.add(0, 0, s.max[op].load(std::memory_order_relaxed));
+        }
+        return h;
+    }
+
+    std::vector<ResizePause> pauses() const {
+        std::lock_guard<std::mutex> lock(pauseLock_);
+        return pauses_;
+    }
+
+    // one line per operation with samples, then the resize-pause log
+    void report(std::ostream& out, const char* const names[NumOps]) const {
+        for (int op = 0; op < NumOps; ++op) {
+            LatencyHistogram h = histogram(op);
+            if (!h.count()) continue;
+            out << "  " << names[op] << ": n=" << h.count()
+                << " p50=" << h.percentile(0.5) << "ns"
+                << " p99=" << h.percentile(0.99) << "ns"
+                << " p99.9=" << h.percentile(0.999) << "ns"
+                << " max=" << h.max() << "ns\n";
+        }
+        for (const ResizePause& p : pauses()) {
+            out << "  pause at " << p.startNs / 1000 << "us: " << p.ns / 1000 << "us ("
+                << p.oldCapacity << " -> " << p.newCapacity << " slots)\n";
+        }
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[NumOps][LatencyHistogram::BUCKETS];
+        std::atomic<uint64_t> max[NumOps];
+        Shard() {
+            for (int op = 0; op < NumOps; ++op) {
+                for (int b = 0; b < LatencyHistogram::BUCKETS; ++b) counts[op][b].store(0);
+                max[op].store(0);
+            }
+        }
+    };
+
+    static std::size_t shardIndex() {
+        return std::hash<std::thread::id>()(std::this_thread::get_id()) % SHARDS;
+    }
+
+    // std::allocator ignores alignas(64) before C++17; allocPages aligns to a line
+    std::vector<Shard, HugePageAllocator<Shard> > shards_;
+    Clock::time_point created_;
+    mutable std::mutex pauseLock_;
+    std::vector<ResizePause> pauses_;
+};
+
+// times its own lifetime into rec (does nothing when rec is null)
+template<typename Recorder>
+class LatencyTimer {
+public:
+    LatencyTimer(Recorder* rec, int op) : rec_(rec), op_(op) {
+        if (rec_) start_ = Recorder::Clock::now();
+    }
+    ~LatencyTimer() {
+        if (rec_) rec_->record(op_, elapsedNs());
+    }
+    uint64_t elapsedNs() const {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Recorder::Clock::now() - start_).count());
+    }
+    typename Recorder::Clock::time_point start() const { return start_; }
+
+private:
+    Recorder* rec_;
+    int op_;
+    typename Recorder::Clock::time_point start_;
+};
+
+#endif // LATENCY_H
@@ -0,0 +1,275 @@
+#ifndef LINEARHASH_H
+#define LINEARHASH_H
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+
+#include "ht.h"
+
+// -----------------------------------------------------------------------------
+// Linear hashing (Litwin): a chained table that grows one bucket at a time.
+// Buckets 0 .. split_-1 have already been split into their image at
+// split_ + base_, so a hash h lives in bucket h mod base_, or h mod 2*base_
+// when that falls below split_. Each insert that pushes the load over
+// maxLoad splits the next bucket in order (more than one only when maxLoad
+// is below 1), and a remove that drops it under a quarter of maxLoad merges
+// the last buckets back (about four per remove once shrinking), so no
+// operation touches more than a few chains. Buckets live in fixed-size
+// segments and the directory only holds segment pointers, so memory grows
+// by one segment at a time rather than by whole-table copies.
+// -----------------------------------------------------------------------------
+
+template<
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename KEqual = std::equal_to<K>
+>
+class LinearHashTable {
+public:
+    typedef K KeyType;
+    typedef V ValueType;
+    typedef std::pair<KeyType,ValueType> ItemType;
+
+    static const size_t SEGMENT_BUCKETS = 256;
+    static const size_t INITIAL_BUCKETS = 8;
+
+    struct Stats {
+        size_t size;          // live elements
+        size_t buckets;       // buckets in use
+        size_t segments;      // segments allocated
+        size_t splits;        // buckets split since construction
+        size_t merges;        // buckets merged back since construction
+        size_t longestChain;
+    };
+
+    // maxLoad is the average chain length that triggers a split
+    LinearHashTable(double maxLoad = 1.0,
+                    const Hash& hash = Hash(),
+                    const KEqual& kequal = KEqual())
+      : hash_(hash), kequal_(kequal), maxLoad_(maxLoad), elementCount_(0),
+        base_(INITIAL_BUCKETS), split_(0), splits_(0), merges_(0), latency_(nullptr)
+    {
+        addSegment();
+    }
+
+    ~LinearHashTable() {
+        for (size_t b = 0; b < bucketCount(); ++b) {
+            Node* n = bucket(b);
+            while (n) {
+                Node* next = n->next;
+                delete n;
+                n = next;
+            }
+        }
+    }
+
+    LinearHashTable(const LinearHashTable&) = delete;
+    LinearHashTable& operator=(const LinearHashTable&) = delete;
+
+    // time every operation into latency (nullptr detaches)
+    void setLatencyRecorder(HashLatency* latency) { latency_ = latency; }
+
+    bool empty() const { return elementCount_ == 0; }
+    size_t size() const { return elementCount_; }
+    size_t bucketCount() const { return base_ + split_; }
+
+    Stats stats() const {
+        Stats s;
+        s.size = elementCount_;
+        s.buckets = bucketCount();
+        s.segments = segments_.size();
+        s.splits = splits_;
+        s.merges = merges_;
+        s.longestChain = 0;
+        for (size_t b = 0; b < bucketCount(); ++b) {
+            size_t len = 0;
+            for (Node* n = bucket(b); n; n = n->next) ++len;
+            if (len > s.longestChain) s.longestChain = len;
+        }
+        return s;
+    }
+
+    // bytes used by segments, chain nodes and key/value heap buffers
+    MemoryUsage memoryUsage() const {
+        MemoryUsage mu;
+        mu.slotBytes = segments_.size() * SEGMENT_BUCKETS * sizeof(Node*) +
+                       segments_.capacity() * sizeof(std::unique_ptr<Node*[]>);
+        for (size_t b = 0; b < bucketCount(); ++b) {
+            for (Node* n = bucket(b); n; n = n->next) {
+                mu.nodeBytes += sizeof(Node);
+                mu.heapBytes += heapBytes(n->item.first) + heapBytes(n->item.second);
+            }
+        }
+        return mu;
+    }
+
+    void insert(const ItemType& p) {
+        LatencyTimer<HashLatency> timer(latency_, OP_INSERT);
+        findOrInsert(p.first)->item.second = p.second;
+    }
+
+    void remove(const KeyType& key) {
+        LatencyTimer<HashLatency> timer(latency_, OP_REMOVE);
+        size_t hv = hashOf(key);
+        Node** link = &bucket(address(hv));
+        while (*link && !((*link)->hash == hv && kequal_((*link)->item.first, key)))
+            link = &(*link)->next;
+        if (!*link) return;
+        Node* dead = *link;
+        *link = dead->next;
+        delete dead;
+        --elementCount_;
+        while (bucketCount() > INITIAL_BUCKETS &&
+               double(elementCount_) < maxLoad_ / 4 * double(bucketCount()))
+            mergeOne();
+    }
+
+    ItemType* find(const KeyType& key) {
+        LatencyTimer<HashLatency> timer(latency_, OP_FIND);
+        Node* n = internalFind(key);
+        return n ? &n->item : nullptr;
+    }
+    const ItemType* find(const KeyType& key) const {
+        LatencyTimer<HashLatency> timer(latency_, OP_FIND);
+        Node* n = internalFind(key);
+        return n ? &n->item : nullptr;
+    }
+
+    ValueType& at(const KeyType& key) {
+        ItemType* it = find(key);
+        if (!it) throw std::out_of_range("Bad key");
+        return it->second;
+    }
+    const ValueType& at(const KeyType& key) const {
+        const ItemType* it = find(key);
+        if (!it) throw std::out_of_range("Bad key");
+        return it->second;
+    }
+
+    // non-const operator[]: insert if missing
+    ValueType& operator[](const KeyType& key) {
+        LatencyTimer<HashLatency> timer(latency_, OP_INDEX);
+        return findOrInsert(key)->item.second;
+    }
+    const ValueType& operator[](const KeyType& key) const { return at(key); }
+
+    // add delta to key's value (starting from ValueType()); returns the new value
+    ValueType& increment(const KeyType& key, const ValueType& delta) {
+        LatencyTimer<HashLatency> timer(latency_, OP_INDEX);
+        ValueType& v = findOrInsert(key)->item.second;
+        v += delta;
+        return v;
+    }
+
+    // call f(item) for every item, in bucket order
+    template<typename F>
+    void forEach(F f) const {
+        for (size_t b = 0; b < bucketCount(); ++b)
+            for (Node* n = bucket(b); n; n = n->next) f(static_cast<const ItemType&>(n->item));
+    }
+
+private:
+    // the full (mixed) hash is kept so splits never call Hash again
+    struct Node {
+        ItemType item;
+        size_t hash;
+        Node* next;
+        Node(const KeyType& key, size_t hv, Node* nxt) : item(key, ValueType()), hash(hv), next(nxt) {}
+    };
+
+    Node*& bucket(size_t b) const { return segments_[b / SEGMENT_BUCKETS][b % SEGMENT_BUCKETS]; }
+
+    // Addresses keep only the low bits, and std::hash is the identity for
+    // integers, so keys sharing their low bits would share a few chains;
+    // remixing spreads every bit of the hash into the ones kept.
+    size_t hashOf(const KeyType& key) const { return size_t(mixHash(hash_(key))); }
+
+    // base_ is a power of two, so both moduli are masks
+    size_t address(size_t hv) const {
+        size_t b = hv & (base_ - 1);
+        if (b < split_) b = hv & (2 * base_ - 1);
+        return b;
+    }
+
+    Node* internalFind(const KeyType& key) const {
+        size_t hv = hashOf(key);
+        for (Node* n = bucket(address(hv)); n; n = n->next)
+            if (n->hash == hv && kequal_(n->item.first, key)) return n;
+        return nullptr;
+    }
+
+    Node* findOrInsert(const KeyType& key) {
+        size_t hv = hashOf(key);
+        Node*& head = bucket(address(hv));
+        for (Node* n = head; n; n = n->next)
+            if (n->hash == hv && kequal_(n->item.first, key)) return n;
+        Node* fresh = new Node(key, hv, head);
+        head = fresh;
+        ++elementCount_;
+        while (double(elementCount_) > maxLoad_ * double(bucketCount())) splitOne();
+        return fresh;
+    }
+
+    void addSegment() {
+        segments_.emplace_back(new Node*[SEGMENT_BUCKETS]());
+    }
+
+    // move the items of bucket split_ that now address its image
+    void splitOne() {
+        size_t image = split_ + base_;
+        if (image / SEGMENT_BUCKETS >= segments_.size()) addSegment();
+        Node* n = bucket(split_);
+        Node** keep = &bucket(split_);
+        Node** move = &bucket(image);
+        while (n) {
+            Node* next = n->next;
+            if (n->hash & base_) { *move = n; move = &n->next; }
+            else { *keep = n; keep = &n->next; }
+            n = next;
+        }
+        *keep = nullptr;
+        *move = nullptr;
+        ++splits_;
+        if (++split_ == base_) {
+            base_ *= 2;
+            split_ = 0;
+        }
+    }
+
+    // fold the last bucket back into the one it was split from
+    void mergeOne() {
+        if (split_ == 0) {
+            base_ /= 2;
+            split_ = base_;
+        }
+        --split_;
+        size_t image = split_ + base_;
+        Node*& last = bucket(image);
+        if (last) {
+            Node* tail = last;
+            while (tail->next) tail = tail->next;
+            tail->next = bucket(split_);
+            bucket(split_) = last;
+            last = nullptr;
+        }
+        ++merges_;
+        if (image % SEGMENT_BUCKETS == 0 && image / SEGMENT_BUCKETS + 1 == segments_.size())
+            segments_.pop_back();
+    }
+
+    Hash hash_;
+    KEqual kequal_;
+    double maxLoad_;
+    size_t elementCount_;
+    size_t base_;   // buckets at the start of this round, a power of two
+    size_t split_;  // next bucket to split
+    size_t splits_;
+    size_t merges_;
+    std::vector<std::unique_ptr<Node*[]> > segments_;
+    HashLatency* latency_;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MULTIMAP_H
+#define MULTIMAP_H
+
+#include <vector>
+#include <functional>
+
+#include "ht.h"
+
+// -----------------------------------------------------------------------------
+// Multimap on top of HashTable: each key owns one contiguous vector of
+// values, so all values of a key are read with a single lookup and a
+// sequential scan. add() appends with one probe sequence via upsert().
+// -----------------------------------------------------------------------------
+
+template<
+    typename K,
+    typename V,
+    typename Prober = LinearProber<K>,
+    typename Hash = std::hash<K>,
+    typename KEqual = std::equal_to<K>
+>
+class HashMultiMap {
+public:
+    typedef std::vector<V> ValueList;
+    typedef HashTable<K, ValueList, Prober, Hash, KEqual> Table;
+
+    HashMultiMap(double resizeAlpha = 0.4,
+                 const Prober& prober = Prober(),
+                 const Hash& hash = Hash(),
+                 const KEqual& kequal = KEqual())
+      : table_(resizeAlpha, prober, hash, kequal), values_(0) {}
+
+    void add(const K& key, const V& value) {
+        table_.upsert(key, [&value](ValueList& list) { list.push_back(value); });
+        ++values_;
+    }
+
+    // every value added for key in insertion order, or nullptr
+    const ValueList* values(const K& key) const {
+        const typename Table::ItemType* it = table_.find(key);
+        return it ? &it->second : nullptr;
+    }
+
+    size_t count(const K& key) const {
+        const ValueList* list = values(key);
+        return list ? list->size() : 0;
+    }
+
+    // drop key and all of its values
+    void remove(const K& key) {
+        const ValueList* list = values(key);
+        if (!list) return;
+        values_ -= list->size();
+        table_.remove(key);
+    }
+
+    size_t keys() const { return table_.size(); }
+    size_t size() const { return values_; }
+
+    const Table& table() const { return table_; }
+    MemoryUsage memoryUsage() const { return table_.memoryUsage(); }
+
+private:
+    Table table_;
+    size_t values_;
+};
+
+#endif // MULTIMAP_H
@@ -0,0 +1,172 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Hardware performance counters for the benchmark targets
+// -----------------------------------------------------------------------------
+
+// Per-thread user-space counters read with perf_event_open. The events
+// are opened as one group, so the PMU schedules them together and a read
+// returns every count for the same interval. An event the kernel or VM
+// refuses is left out of the group and the rest still report; with none
+// available the benchmarks fall back to wall time only. When the group
+// shares the PMU with other users it is multiplexed: counts are scaled by
+// time enabled / time running and the report says so.
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, EVENT_COUNT };
+
+    PerfCounters() : leader_(-1), members_(0), enabled_(0), running_(0) {
+        for (int e = 0; e < EVENT_COUNT; ++e) {
+            fds_[e] = -1;
+            values_[e] = 0;
+            order_[e] = EVENT_COUNT;
+        }
+#ifdef __linux__
+        const uint32_t types[EVENT_COUNT] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+        };
+        const uint64_t configs[EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+            PERF_COUNT_HW_CACHE_MISSES,
+            cacheEvent(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for (int e = 0; e < EVENT_COUNT; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[e];
+            attr.config = configs[e];
+            attr.disabled = leader_ < 0;  // members follow the leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[e] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader_, 0));
+            if (fds_[e] < 0) continue;
+            if (leader_ < 0) leader_ = fds_[e];
+            order_[members_++] = e;
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+        for (int e = 0; e < EVENT_COUNT; ++e)
+            if (fds_[e] >= 0 && fds_[e] != leader_) close(fds_[e]);
+        if (leader_ >= 0) close(leader_);
+    }
+
+    bool has(Event e) const { return fds_[e] >= 0; }
+    bool available() const { return leader_ >= 0; }
+
+    void start() {
+#ifdef __linux__
+        if (leader_ < 0) return;
+        ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // read the group: {nr, time_enabled, time_running, value[nr]}, values
+    // in the order the members were opened
+    void stop() {
+#ifdef __linux__
+        if (leader_ < 0) return;
+        ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t buf[3 + EVENT_COUNT];
+        ssize_t want = ssize_t(sizeof(uint64_t) * (3 + members_));
+        bool ok = read(leader_, buf, sizeof(buf)) == want && buf[0] == uint64_t(members_);
+        enabled_ = ok ? buf[1] : 0;
+        running_ = ok ? buf[2] : 0;
+        for (int i = 0; i < members_; ++i) {
+            double v = double(ok ? buf[3 + i] : 0);
+            if (running_ && running_ < enabled_) v *= double(enabled_) / double(running_);
+            values_[order_[i]] = uint64_t(v);
+        }
+#endif
+    }
+
+    // the last interval's counts were extrapolated from part of it
+    bool multiplexed() const { return running_ < enabled_; }
+
+    uint64_t value(Event e) const { return values_[e]; }
+
+    // counts of the last start/stop interval divided by ops, plus IPC
+    void report(std::ostream& out, size_t ops) const {
+        static const char* const names[EVENT_COUNT] = {
+            "cycles", "instructions", "L1d-miss", "LLC-miss", "dTLB-miss", "branch-miss"
+        };
+        double n = ops ? double(ops) : 1.0;
+        out << "   ";
+        for (int e = 0; e < EVENT_COUNT; ++e) {
+            out << " " << names[e] << "/op=";
+            if (has(Event(e))) out << double(values_[e]) / n;
+            else out << "n/a";
+        }
+        if (has(CYCLES) && has(INSTRUCTIONS) && values_[CYCLES])
+            out << " IPC=" << double(values_[INSTRUCTIONS]) / double(values_[CYCLES]);
+        if (available() && running_ == 0) out << " (counters never scheduled)";
+        else if (multiplexed())
+            out << " (multiplexed, scaled from " << 100.0 * double(running_) / double(enabled_) << "%)";
+        out << std::endl;
+    }
+
+private:
+#ifdef __linux__
+    static uint64_t cacheEvent(uint64_t cache, uint64_t op, uint64_t result) {
+        return cache | (op << 8) | (result << 16);
+    }
+#endif
+
+    int fds_[EVENT_COUNT];
+    uint64_t values_[EVENT_COUNT];
+    int leader_;
+    int order_[EVENT_COUNT];  // group read position -> event
+    int members_;
+    uint64_t enabled_;
+    uint64_t running_;
+};
+
+// One measured benchmark phase: wall time, plus hardware counters when a
+// PerfCounters is supplied. Construct right before the work, call done() after.
+class BenchPhase {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit BenchPhase(PerfCounters* pc = nullptr) : pc_(pc) {
+        if (pc_) pc_->start();
+        start_ = Clock::now();
+    }
+
+    // print "name: ops, ms, ns/op" and per-op counters; returns elapsed ns
+    double done(const std::string& name, size_t ops, std::ostream& out = std::cout) {
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start_).count();
+        if (pc_) pc_->stop();
+        out << "  " << name << ": " << ops << " ops, " << ns / 1e6 << " ms, "
+            << (ops ? ns / ops : 0.0) << " ns/op" << std::endl;
+        if (pc_) pc_->report(out, ops);
+        return ns;
+    }
+
+private:
+    PerfCounters* pc_;
+    Clock::time_point start_;
+};
+
+#endif // PERF_H
@@ -0,0 +1,129 @@
+#include "hash.h"
+#include "perf.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+typedef function<size_t(const string&)> HashFn;
+
+// keys that stay in L1 (hot) versus a set far larger than the last-level
+// cache visited in shuffled order (cold)
+static const size_t HOT_KEYS = 256;
+static const size_t COLD_KEYS = 1 << 20;
+static const size_t HASHES_PER_RUN = 1 << 20;
+
+static const char ALNUM[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+string randomKey(mt19937& gen, size_t len) {
+    string k(len, 'a');
+    for (size_t i = 0; i < len; ++i) k[i] = ALNUM[gen() % (sizeof(ALNUM) - 1)];
+    return k;
+}
+
+uint64_t cycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Hash HASHES_PER_RUN keys taken from keys in order and print ns/hash and
+// bytes/cycle. Cycles come from the hardware counter when available, else
+// from the time-stamp counter.
+void measure(const string& workload, const string& variant, const HashFn& fn,
+             const vector<string>& keys, PerfCounters* pc) {
+    size_t bytes = 0;
+    size_t sink = 0;
+    if (pc) pc->start();
+    uint64_t tsc = cycleCounter();
+    auto t = chrono::steady_clock::now();
+    for (size_t i = 0, j = 0; i < HASHES_PER_RUN; ++i) {
+        const string& k = keys[j];
+        sink += fn(k);
+        bytes += k.size();
+        if (++j == keys.size()) j = 0;
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t).count();
+    uint64_t cycles = cycleCounter() - tsc;
+    if (pc) {
+        pc->stop();
+        if (pc->has(PerfCounters::CYCLES)) cycles = pc->value(PerfCounters::CYCLES);
+    }
+    cout << left << setw(22) << workload << setw(12) << variant << right
+         << setw(10) << fixed << setprecision(2) << ns / HASHES_PER_RUN << " ns/hash"
+         << setw(10) << (cycles ? double(bytes) / cycles : 0.0) << " bytes/cycle";
+    cout << (sink == 42 ? " " : "") << endl;  // keep sink live
+}
+
+// every variant on one key set, hot then cold
+void measureAll(const string& name, const vector<string>& pool, const vector<pair<string,HashFn> >& variants,
+                PerfCounters* pc, mt19937& gen) {
+    vector<string> hot(pool.begin(), pool.begin() + min(pool.size(), HOT_KEYS));
+    vector<string> cold;
+    cold.reserve(COLD_KEYS);
+    for (size_t i = 0; i < COLD_KEYS; ++i) cold.push_back(pool[gen() % pool.size()]);
+    for (const auto& v : variants) measure(name + " hot", v.first, v.second, hot, pc);
+    for (const auto& v : variants) measure(name + " cold", v.first, v.second, cold, pc);
+}
+
+int main(int argc, char* argv[])
+{
+    string dictFile = "dict.txt";
+    PerfCounters counters;
+    PerfCounters* pc = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "-p") pc = &counters;
+        else dictFile = arg;
+    }
+    if (pc && !counters.available()) {
+        cout << "hardware counters unavailable; bytes/cycle uses the time-stamp counter" << endl;
+        pc = nullptr;
+    }
+
+    MyStringHash h(true);
+    hash<string> stdHash;
+    vector<pair<string,HashFn> > variants;
+    variants.push_back(make_pair("scalar", HashFn([&h](const string& k) { return h(k); })));
+    variants.push_back(make_pair("table", HashFn([&h](const string& k) { return h.hashTableDriven(k); })));
+    variants.push_back(make_pair("simd", HashFn([&h](const string& k) { return h.hashSimd(k); })));
+    variants.push_back(make_pair("std::hash", HashFn([&stdHash](const string& k) { return stdHash(k); })));
+
+    mt19937 gen(104);
+    // fixed lengths around the 6-char chunk edges and the 30-char window
+    const size_t lengths[] = {0, 1, 5, 6, 7, 12, 13, 16, 24, 29, 30, 31, 32, 48, 64};
+    for (size_t len : lengths) {
+        vector<string> pool;
+        for (size_t i = 0; i < 4096; ++i) pool.push_back(randomKey(gen, len));
+        measureAll("len " + to_string(len), pool, variants, pc, gen);
+    }
+
+    vector<string> uniform;
+    for (size_t i = 0; i < 4096; ++i) uniform.push_back(randomKey(gen, gen() % 65));
+    measureAll("uniform 0-64", uniform, variants, pc, gen);
+
+    ifstream in(dictFile.c_str());
+    vector<string> words;
+    string w;
+    while (in >> w) words.push_back(w);
+    if (words.empty()) {
+        cout << "Usage: str-hash-perf [dictionary file] [-p]" << endl;
+        return 1;
+    }
+    shuffle(words.begin(), words.end(), gen);
+    measureAll("dict.txt lengths", words, variants, pc, gen);
+    return 0;
+}
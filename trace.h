@@ -0,0 +1,165 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+
+#include "ht.h"
+
+// -----------------------------------------------------------------------------
+// Operation traces: record the public calls a HashTable sees, then replay
+// them against other prober/hash/storage configurations.
+//
+// Binary format: the 8-byte magic "HTTRACE1", then one record per call.
+// A record is a tag byte (HashOp in the low bits, NEW_KEY_FLAG when the key
+// is seen for the first time) followed by either the new key's bytes, which
+// give it the next key id, or the varint id of a key seen before.
+// -----------------------------------------------------------------------------
+
+static const char TRACE_MAGIC[8] = {'H','T','T','R','A','C','E','1'};
+static const uint8_t NEW_KEY_FLAG = 0x80;
+
+inline void writeVarint(std::ostream& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.put(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.put(static_cast<char>(v));
+}
+
+inline bool readVarint(std::istream& in, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return false;
+        v |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// keys are written as raw bytes for arithmetic types, length + bytes for strings
+template<typename K>
+typename std::enable_if<std::is_arithmetic<K>::value>::type
+writeKey(std::ostream& out, const K& key) {
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+}
+template<typename K>
+typename std::enable_if<std::is_arithmetic<K>::value, bool>::type
+readKey(std::istream& in, K& key) {
+    return bool(in.read(reinterpret_cast<char*>(&key), sizeof(key)));
+}
+inline void writeKey(std::ostream& out, const std::string& key) {
+    writeVarint(out, key.size());
+    out.write(key.data(), key.size());
+}
+inline bool readKey(std::istream& in, std::string& key) {
+    uint64_t len;
+    if (!readVarint(in, len)) return false;
+    key.resize(len);
+    return len == 0 || bool(in.read(&key[0], len));
+}
+
+// one recorded call
+struct TraceRecord {
+    uint8_t op;      // HashOp
+    uint32_t keyId;  // index into Trace::keys
+};
+
+// a trace loaded for replay: distinct keys in first-seen order, then the calls
+template<typename K>
+struct Trace {
+    std::vector<K> keys;
+    std::vector<TraceRecord> ops;
+};
+
+// OpObserver that streams a binary trace; attach with HashTable::setObserver
+template<typename K, typename Hash = std::hash<K> >
+class TraceRecorder : public OpObserver<K> {
+public:
+    TraceRecorder(std::ostream& out) : out_(out), ids_(0.5), records_(0) {
+        out_.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    }
+
+    void onOp(HashOp op, const K& key) {
+        const std::pair<K,uint32_t>* id = ids_.find(key);
+        if (id) {
+            out_.put(static_cast<char>(op));
+            writeVarint(out_, id->second);
+        } else {
+            ids_.insert({key, static_cast<uint32_t>(ids_.size())});
+            out_.put(static_cast<char>(op | NEW_KEY_FLAG));
+            writeKey(out_, key);
+        }
+        ++records_;
+    }
+
+    size_t records() const { return records_; }
+    size_t distinctKeys() const { return ids_.size(); }
+
+private:
+    std::ostream& out_;
+    HashTable<K, uint32_t, LinearProber<K>, Hash> ids_;
+    size_t records_;
+};
+
+template<typename K>
+Trace<K> readTrace(std::istream& in) {
+    char magic[sizeof(TRACE_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)
+        throw std::invalid_argument("not a HashTable trace");
+    Trace<K> trace;
+    int tag;
+    while ((tag = in.get()) != EOF) {
+        TraceRecord rec;
+        rec.op = static_cast<uint8_t>(tag & ~NEW_KEY_FLAG);
+        if (tag & NEW_KEY_FLAG) {
+            K key;
+            if (!readKey(in, key)) throw std::invalid_argument("truncated trace key");
+            rec.keyId = static_cast<uint32_t>(trace.keys.size());
+            trace.keys.push_back(key);
+        } else {
+            uint64_t id;
+            if (!readVarint(in, id) || id >= trace.keys.size())
+                throw std::invalid_argument("bad trace key id");
+            rec.keyId = static_cast<uint32_t>(id);
+        }
+        if (rec.op > OP_INDEX) throw std::invalid_argument("bad trace op");
+        trace.ops.push_back(rec);
+    }
+    return trace;
+}
+
+// value written by replayed inserts: the key id when it converts, else V()
+template<typename V>
+typename std::enable_if<std::is_convertible<uint32_t, V>::value, V>::type
+traceValue(uint32_t id) { return V(id); }
+template<typename V>
+typename std::enable_if<!std::is_convertible<uint32_t, V>::value, V>::type
+traceValue(uint32_t) { return V(); }
+
+// Apply every call in trace to ht in order. Returns the number of
+// finds that hit, which must match between configurations.
+template<typename Table>
+size_t replayTrace(const Trace<typename Table::KeyType>& trace, Table& ht) {
+    typedef typename Table::ValueType V;
+    size_t hits = 0;
+    for (const TraceRecord& rec : trace.ops) {
+        const typename Table::KeyType& key = trace.keys[rec.keyId];
+        switch (rec.op) {
+            case OP_INSERT: ht.insert({key, traceValue<V>(rec.keyId)}); break;
+            case OP_FIND: hits += ht.find(key) != nullptr; break;
+            case OP_REMOVE: ht.remove(key); break;
+            case OP_INDEX: ht[key] = traceValue<V>(rec.keyId); break;
+        }
+    }
+    return hits;
+}
+
+#endif // TRACE_H
@@ -0,0 +1,88 @@
+#ifndef RECCHECK
+#include <cstring>
+#endif
+
+#include "trie.h"
+
+DictTrie::DictTrie() : nodes_(1), words_(0)
+{
+	std::memset(&nodes_[0], 0, sizeof(Node));
+	nodes_[0].required = ALL_LETTERS;
+}
+
+DictTrie::DictTrie(const std::set<std::string>& dict) : nodes_(1), words_(0)
+{
+	std::memset(&nodes_[0], 0, sizeof(Node));
+	for(std::set<std::string>::const_iterator it = dict.begin(); it != dict.end(); ++it)
+	{
+		if(insert(*it)) words_++;
+	}
+	summarize();
+}
+
+uint32_t DictTrie::letterMask(const std::string& s)
+{
+	uint32_t mask = 0;
+	for(unsigned int i=0;i<s.size();i++)
+	{
+		if(s[i] >= 'A' && s[i] <= 'Z') mask |= 1u << (s[i] - 'A');
+	}
+	return mask;
+}
+
+bool DictTrie::insert(const std::string& word)
+{
+	for(unsigned int i=0;i<word.size();i++)
+	{
+		if(word[i] < 'A' || word[i] > 'Z') return false;
+	}
+	uint32_t node = 0;
+	for(unsigned int i=0;i<word.size();i++)
+	{
+		uint32_t& next = nodes_[node].next[word[i] - 'A'];
+		if(next == NONE)
+		{
+			Node fresh;
+			std::memset(&fresh, 0, sizeof(fresh));
+			next = nodes_.size();
+			nodes_.push_back(fresh);
+		}
+		node = nodes_[node].next[word[i] - 'A'];
+	}
+	bool added = !nodes_[node].word;
+	nodes_[node].word = true;
+	return added;
+}
+
+// Children always follow their parent in nodes_, so one backward pass sees
+// every subtree before its root. A node's own path letters are the mask of
+// its parent's path plus its edge letter, found in a forward pass first.
+void DictTrie::summarize()
+{
+	std::vector<uint32_t> pathMask(nodes_.size(), 0);
+	for(uint32_t n=0;n<nodes_.size();n++)
+	{
+		for(int c=0;c<26;c++)
+		{
+			uint32_t next = nodes_[n].next[c];
+			if(next != NONE) pathMask[next] = pathMask[n] | (1u << c);
+		}
+	}
+	for(uint32_t n=nodes_.size();n-- > 0;)
+	{
+		uint32_t req = nodes_[n].word ? pathMask[n] : ALL_LETTERS;
+		for(int c=0;c<26;c++)
+		{
+			uint32_t next = nodes_[n].next[c];
+			if(next != NONE) req &= nodes_[next].required;
+		}
+		nodes_[n].required = req;
+	}
+}
+
+MemoryUsage DictTrie::memoryUsage() const
+{
+	MemoryUsage mu;
+	mu.nodeBytes = nodes_.capacity() * sizeof(Node);
+	return mu;
+}
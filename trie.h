@@ -0,0 +1,58 @@
+#ifndef TRIE_H
+#define TRIE_H
+
+#ifndef RECCHECK
+#include <vector>
+#include <set>
+#include <string>
+#include <cstdint>
+#endif
+
+#include "alloc.h"
+
+// Dictionary as a table-driven trie over A-Z: node i's transitions are
+// next[26] entries in one flat array, 0 meaning no edge (the root is never
+// a child). Each node also keeps the letters shared by every word in its
+// subtree, so a search can skip subtrees needing a letter the board lacks.
+class DictTrie
+{
+public:
+	static const uint32_t NONE = 0;
+	static const uint32_t ALL_LETTERS = (1u << 26) - 1;
+
+	struct Node
+	{
+		uint32_t next[26];
+		uint32_t required;  // AND of the letter masks of all words below
+		bool word;
+	};
+
+	DictTrie();
+	// words holding anything but A-Z are skipped; no board can spell them
+	explicit DictTrie(const std::set<std::string>& dict);
+
+	uint32_t root() const { return 0; }
+	uint32_t child(uint32_t node, char letter) const
+	{
+		return (letter >= 'A' && letter <= 'Z') ? nodes_[node].next[letter - 'A'] : NONE;
+	}
+	bool isWord(uint32_t node) const { return nodes_[node].word; }
+	uint32_t required(uint32_t node) const { return nodes_[node].required; }
+	const Node* nodes() const { return &nodes_[0]; }
+
+	std::size_t size() const { return nodes_.size(); }
+	std::size_t words() const { return words_; }
+	MemoryUsage memoryUsage() const;
+
+	// bit c-'A' set for each letter c of s
+	static uint32_t letterMask(const std::string& s);
+
+private:
+	bool insert(const std::string& word);
+	void summarize();
+
+	std::vector<Node> nodes_;
+	std::size_t words_;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef VERSIONED_H
+#define VERSIONED_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+
+#include "ht.h"
+
+// -----------------------------------------------------------------------------
+// Versioned hash table with copy-on-write chunks (RCU style). Slots live in
+// fixed-size chunks shared between versions through shared_ptr. A writer
+// edits a private draft, copying a chunk the first time it touches it, and
+// publish() swaps the draft in atomically. Readers pin() the current
+// version and query it without locks; a version, and any chunk no other
+// version uses, is freed when its last pin is dropped.
+// -----------------------------------------------------------------------------
+
+template<
+    typename K,
+    typename V,
+    typename Prober = LinearProber<K>,
+    typename Hash = std::hash<K>,
+    typename KEqual = std::equal_to<K>
+>
+class VersionedTable {
+public:
+    typedef K KeyType;
+    typedef V ValueType;
+    typedef std::pair<KeyType,ValueType> ItemType;
+
+    static const size_t CHUNK_SLOTS = 512;
+
+    enum SlotState : uint8_t { EMPTY, FULL, DELETED };
+    struct Slot {
+        SlotState state;
+        ItemType item;
+        Slot() : state(EMPTY) {}
+    };
+    struct Chunk {
+        Slot slots[CHUNK_SLOTS];
+    };
+
+    // hashing state shared by the table and every version, so a pinned
+    // version stays searchable after the table itself is gone
+    struct Functions {
+        Hash hash;
+        KEqual kequal;
+        Prober prober;
+        Functions(const Hash& h, const KEqual& k, const Prober& p) : hash(h), kequal(k), prober(p) {}
+    };
+
+    // one published state of the table; immutable once readers can see it
+    class Version {
+    public:
+        size_t size() const { return size_; }
+        size_t capacity() const { return slots_; }
+        uint64_t number() const { return number_; }
+
+        const ItemType* find(const KeyType& key) const {
+            size_t loc = findLoc(*this, key);
+            return loc == Prober::npos ? nullptr : &slot(loc).item;
+        }
+
+        // chunks this version shares with other's
+        size_t sharedChunks(const Version& other) const {
+            size_t n = 0;
+            for (size_t i = 0; i < chunks_.size() && i < other.chunks_.size(); ++i)
+                n += chunks_[i] == other.chunks_[i];
+            return n;
+        }
+
+    private:
+        friend class VersionedTable;
+        const Slot& slot(size_t i) const { return chunks_[i / CHUNK_SLOTS]->slots[i % CHUNK_SLOTS]; }
+
+        std::vector<std::shared_ptr<Chunk> > chunks_;
+        size_t slots_;  // prime, so every double-hash step covers the table
+        size_t size_;
+        size_t deleted_;
+        uint64_t number_;
+        std::shared_ptr<const Functions> fns_;
+    };
+    typedef std::shared_ptr<const Version> Snapshot;
+
+    VersionedTable(double resizeAlpha = 0.5,
+                   const Prober& prober = Prober(),
+                   const Hash& hash = Hash(),
+                   const KEqual& kequal = KEqual())
+      : fns_(std::make_shared<Functions>(hash, kequal, prober)), resizeAlpha_(resizeAlpha)
+    {
+        std::shared_ptr<Version> first(new Version);
+        first->chunks_.push_back(std::make_shared<Chunk>());
+        first->slots_ = primeAtMost(CHUNK_SLOTS);
+        first->size_ = first->deleted_ = 0;
+        first->number_ = 0;
+        first->fns_ = fns_;
+        current_ = first;
+        startDraft();
+    }
+
+    VersionedTable(const VersionedTable&) = delete;
+    VersionedTable& operator=(const VersionedTable&) = delete;
+
+    // the latest published version; hold the result for as long as it is read
+    Snapshot pin() const { return std::atomic_load(&current_); }
+
+    // writer side: edits go to the draft and become visible on publish()
+    void insert(const ItemType& p) {
+        std::lock_guard<std::mutex> lock(writeLock_);
+        Version& d = *draft_;
+        size_t loc = findLoc(d, p.first);
+        if (loc != Prober::npos) {
+            writable(loc).item.second = p.second;
+            return;
+        }
+        if (double(d.size_ + d.deleted_ + 1) / d.capacity() >= resizeAlpha_) grow();
+        loc = freeLoc(d, p.first);
+        Slot& s = writable(loc);
+        if (s.state == DELETED) --d.deleted_;
+        ++d.size_;
+        s.state = FULL;
+        s.item = p;
+    }
+
+    void remove(const KeyType& key) {
+        std::lock_guard<std::mutex> lock(writeLock_);
+        size_t loc = findLoc(*draft_, key);
+        if (loc == Prober::npos) return;
+        writable(loc).state = DELETED;
+        --draft_->size_;
+        ++draft_->deleted_;
+    }
+
+    // make the draft the current version and start a new draft sharing its chunks
+    Snapshot publish() {
+        std::lock_guard<std::mutex> lock(writeLock_);
+        Snapshot published = draft_;
+        std::atomic_store(&current_, published);
+        startDraft();
+        return published;
+    }
+
+    // chunks the draft has copied (or allocated) since the last publish
+    size_t copiedChunks() const {
+        std::lock_guard<std::mutex> lock(writeLock_);
+        size_t n = 0;
+        for (bool o : owned_) n += o;
+        return n;
+    }
+
+private:
+    void startDraft() {
+        const Version& cur = *current_;
+        draft_.reset(new Version(cur));
+        draft_->number_ = cur.number_ + 1;
+        owned_.assign(cur.chunks_.size(), false);
+    }
+
+    // slot loc of the draft, copying its chunk on the first write since publish
+    Slot& writable(size_t loc) {
+        size_t c = loc / CHUNK_SLOTS;
+        if (!owned_[c]) {
+            draft_->chunks_[c] = std::make_shared<Chunk>(*draft_->chunks_[c]);
+            owned_[c] = true;
+        }
+        return draft_->chunks_[c]->slots[loc % CHUNK_SLOTS];
+    }
+
+    static size_t primeAtMost(size_t n) {
+        for (;; --n) {
+            bool prime = n >= 2;
+            for (size_t f = 2; prime && f * f <= n; ++f) prime = n % f != 0;
+            if (prime) return n;
+        }
+    }
+
+    // Double the chunk count and rehash the draft into fresh chunks. The
+    // slot count is the largest prime that fits, since a power of two would
+    // let an even double-hash step cycle through only part of the table.
+    void grow() {
+        Version& d = *draft_;
+        std::vector<std::shared_ptr<Chunk> > old;
+        old.swap(d.chunks_);
+        size_t chunks = old.size() * 2;
+        for (size_t i = 0; i < chunks; ++i) d.chunks_.push_back(std::make_shared<Chunk>());
+        d.slots_ = primeAtMost(chunks * CHUNK_SLOTS);
+        owned_.assign(chunks, true);
+        d.deleted_ = 0;
+        for (const auto& chunk : old) {
+            for (const Slot& s : chunk->slots) {
+                if (s.state != FULL) continue;
+                size_t loc = freeLoc(d, s.item.first);
+                Slot& t = d.chunks_[loc / CHUNK_SLOTS]->slots[loc % CHUNK_SLOTS];
+                t.state = FULL;
+                t.item = s.item;
+            }
+        }
+    }
+
+    static void initProber(Prober& prober, const Version& v, const KeyType& key) {
+        HASH_INDEX_T m = v.capacity();
+        HASH_INDEX_T hv = v.fns_->hash(key);
+        if (Prober::TAKES_FULL_HASH) prober.initHashed(hv, m, key);
+        else prober.init(hv % m, m, key);
+    }
+
+    // slot holding key, or npos
+    static size_t findLoc(const Version& v, const KeyType& key) {
+        Prober prober(v.fns_->prober);
+        initProber(prober, v, key);
+        for (HASH_INDEX_T loc = prober.next(); loc != Prober::npos; loc = prober.next()) {
+            const Slot& s = v.slot(loc);
+            if (s.state == EMPTY) return Prober::npos;
+            if (s.state == FULL && v.fns_->kequal(s.item.first, key)) return loc;
+        }
+        return Prober::npos;
+    }
+
+    // first empty or deleted slot on key's probe sequence
+    static size_t freeLoc(const Version& v, const KeyType& key) {
+        Prober prober(v.fns_->prober);
+        initProber(prober, v, key);
+        for (HASH_INDEX_T loc = prober.next(); loc != Prober::npos; loc = prober.next())
+            if (v.slot(loc).state != FULL) return loc;
+        throw std::logic_error("VersionedTable full");
+    }
+
+    std::shared_ptr<const Functions> fns_;
+    double resizeAlpha_;
+    std::shared_ptr<const Version> current_;
+    std::shared_ptr<Version> draft_;
+    std::vector<bool> owned_;
+    mutable std::mutex writeLock_;
+};
+
+#endif // VERSIONED_H
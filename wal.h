@@ -0,0 +1,279 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ht.h"
+#include "trace.h"
+
+// -----------------------------------------------------------------------------
+// Persistence for a HashTable: an append-only log of inserts and removes
+// plus a periodic snapshot of the whole table.
+//
+// Log (<path>.log): a sequence of records, each the varint payload length,
+// the payload (HashOp tag byte, key, and the value for inserts) and a 4-byte
+// FNV-1a checksum of the payload. Recovery stops at the first short or
+// damaged record, which is where a crash cut the log off, and truncates it.
+//
+// Snapshot (<path>.snap): the 8-byte magic "HTSNAP01", the varint item
+// count, every key/value pair, then the checksum of everything after the
+// magic. Keys and values are encoded with trace.h's writeKey/readKey.
+// -----------------------------------------------------------------------------
+
+static const char SNAPSHOT_MAGIC[8] = {'H','T','S','N','A','P','0','1'};
+
+inline uint32_t fnv1a32(const char* data, size_t len, uint32_t h = 2166136261u) {
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+inline void writeU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+inline uint32_t readU32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= uint32_t(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+// Wraps a HashTable so every change is logged before it is applied.
+// Construction recovers the table from the snapshot and the log tail, so
+// restart cost is one snapshot load plus the records since the last
+// snapshot(). Log writes are buffered: flush() hands them to the kernel
+// (surviving a process crash) and sync() also forces them to disk.
+// Replaying records that are already in the snapshot is harmless, because
+// each key ends in the state of its last record either way.
+template<typename Table>
+class LoggedTable {
+public:
+    typedef typename Table::KeyType KeyType;
+    typedef typename Table::ValueType ValueType;
+    typedef typename Table::ItemType ItemType;
+
+    static const size_t FLUSH_BYTES = 64 * 1024;
+
+    // snapshotEvery > 0 takes a snapshot whenever the log reaches that many records
+    LoggedTable(Table& table, const std::string& path, size_t snapshotEvery = 0)
+      : table_(table), path_(path), snapshotEvery_(snapshotEvery),
+        logRecords_(0), replayed_(0), fd_(-1)
+    {
+        loadSnapshot();
+        replayLog();
+        fd_ = ::open(logPath().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd_ < 0) throw std::runtime_error("cannot open log " + logPath() + ": " + std::strerror(errno));
+    }
+
+    ~LoggedTable() {
+        try { flush(); } catch (...) {}
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    const Table& table() const { return table_; }
+
+    // log records replayed by recovery, and records written since the last snapshot
+    size_t replayed() const { return replayed_; }
+    size_t logRecords() const { return logRecords_; }
+
+    void insert(const ItemType& p) {
+        append(OP_INSERT, p.first, &p.second);
+        table_.insert(p);
+        maybeSnapshot();
+    }
+
+    void remove(const KeyType& key) {
+        append(OP_REMOVE, key, nullptr);
+        table_.remove(key);
+        maybeSnapshot();
+    }
+
+    const ItemType* find(const KeyType& key) const {
+        const Table& t = table_;
+        return t.find(key);
+    }
+
+    void flush() {
+        size_t done = 0;
+        while (done < pending_.size()) {
+            ssize_t n = ::write(fd_, pending_.data() + done, pending_.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("log write failed: " + std::string(std::strerror(errno)));
+            }
+            done += size_t(n);
+        }
+        pending_.clear();
+    }
+
+    void sync() {
+        flush();
+        if (::fdatasync(fd_) != 0)
+            throw std::runtime_error("log sync failed: " + std::string(std::strerror(errno)));
+    }
+
+    // Write the table to <path>.snap.tmp, sync it, rename it over the old
+    // snapshot and then empty the log. A crash at any point leaves either
+    // the old snapshot with the full log or the new one with a log whose
+    // records it already contains.
+    void snapshot() {
+        flush();
+        std::string tmp = snapPath() + ".tmp";
+        {
+            std::ostringstream body;
+            writeVarint(body, table_.size());
+            table_.forEach([&body](const ItemType& item) {
+                writeKey(body, item.first);
+                writeKey(body, item.second);
+            });
+            std::string data = body.str();
+            std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+            out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+            out.write(data.data(), data.size());
+            std::string sum;
+            writeU32(sum, fnv1a32(data.data(), data.size()));
+            out.write(sum.data(), sum.size());
+            if (!out.flush()) throw std::runtime_error("cannot write snapshot " + tmp);
+        }
+        syncPath(tmp);
+        if (std::rename(tmp.c_str(), snapPath().c_str()) != 0)
+            throw std::runtime_error("cannot rename snapshot: " + std::string(std::strerror(errno)));
+        syncPath(directoryOf(path_));
+        if (::ftruncate(fd_, 0) != 0 || ::fdatasync(fd_) != 0)
+            throw std::runtime_error("cannot truncate log: " + std::string(std::strerror(errno)));
+        logRecords_ = 0;
+    }
+
+private:
+    std::string logPath() const { return path_ + ".log"; }
+    std::string snapPath() const { return path_ + ".snap"; }
+
+    static std::string directoryOf(const std::string& path) {
+        size_t slash = path.rfind('/');
+        if (slash == std::string::npos) return ".";
+        return slash == 0 ? "/" : path.substr(0, slash);
+    }
+
+    static void syncPath(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+        int rc = ::fsync(fd);
+        ::close(fd);
+        if (rc != 0) throw std::runtime_error("cannot sync " + path + ": " + std::strerror(errno));
+    }
+
+    static bool readFile(const std::string& path, std::string& data) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if (!in) return false;
+        std::ostringstream all;
+        all << in.rdbuf();
+        data = all.str();
+        return true;
+    }
+
+    void append(HashOp op, const KeyType& key, const ValueType* value) {
+        record_.str("");
+        record_.put(static_cast<char>(op));
+        writeKey(record_, key);
+        if (value) writeKey(record_, *value);
+        std::string payload = record_.str();
+        std::ostringstream len;
+        writeVarint(len, payload.size());
+        pending_ += len.str();
+        pending_ += payload;
+        writeU32(pending_, fnv1a32(payload.data(), payload.size()));
+        ++logRecords_;
+        if (pending_.size() >= FLUSH_BYTES) flush();
+    }
+
+    void maybeSnapshot() {
+        if (snapshotEvery_ && logRecords_ >= snapshotEvery_) snapshot();
+    }
+
+    // bulk load: size the table for the whole snapshot before inserting
+    void loadSnapshot() {
+        std::string data;
+        if (!readFile(snapPath(), data)) return;
+        size_t magic = sizeof(SNAPSHOT_MAGIC);
+        if (data.size() < magic + 4 || std::memcmp(data.data(), SNAPSHOT_MAGIC, magic) != 0)
+            throw std::runtime_error("not a HashTable snapshot: " + snapPath());
+        size_t bodyLen = data.size() - magic - 4;
+        if (fnv1a32(data.data() + magic, bodyLen) != readU32(data.data() + magic + bodyLen))
+            throw std::runtime_error("snapshot checksum mismatch: " + snapPath());
+        std::istringstream in(data.substr(magic, bodyLen));
+        uint64_t count;
+        if (!readVarint(in, count)) throw std::runtime_error("truncated snapshot: " + snapPath());
+        table_.reserve(table_.size() + count);
+        for (uint64_t i = 0; i < count; ++i) {
+            ItemType item;
+            if (!readKey(in, item.first) || !readKey(in, item.second))
+                throw std::runtime_error("truncated snapshot: " + snapPath());
+            table_.insert(item);
+        }
+    }
+
+    // Decode every intact log record, then apply them with the table sized
+    // once for all inserts. A damaged tail is cut off so appends follow the
+    // last good record.
+    void replayLog() {
+        std::string data;
+        if (!readFile(logPath(), data)) return;
+        std::vector<std::pair<HashOp, ItemType> > ops;
+        size_t good = 0, inserts = 0;
+        std::istringstream in(data);
+        for (;;) {
+            uint64_t len;
+            if (!readVarint(in, len)) break;
+            size_t start = size_t(in.tellg());
+            // len is untrusted: a torn varint can be near 2^64, so no sums
+            if (len == 0 || start > data.size() || data.size() - start < 4 ||
+                len > data.size() - start - 4) break;
+            const char* payload = data.data() + start;
+            if (fnv1a32(payload, len) != readU32(payload + len)) break;
+            std::istringstream rec(std::string(payload, len));
+            std::pair<HashOp, ItemType> op;
+            op.first = static_cast<HashOp>(rec.get());
+            if (!readKey(rec, op.second.first)) break;
+            if (op.first == OP_INSERT) {
+                if (!readKey(rec, op.second.second)) break;
+                ++inserts;
+            } else if (op.first != OP_REMOVE) {
+                break;
+            }
+            ops.push_back(op);
+            good = start + len + 4;
+            in.seekg(std::streamoff(good));
+        }
+        table_.reserve(table_.size() + inserts);
+        for (const auto& op : ops) {
+            if (op.first == OP_INSERT) table_.insert(op.second);
+            else table_.remove(op.second.first);
+        }
+        replayed_ = logRecords_ = ops.size();
+        if (good < data.size() && ::truncate(logPath().c_str(), off_t(good)) != 0)
+            throw std::runtime_error("cannot truncate damaged log tail: " + std::string(std::strerror(errno)));
+    }
+
+    Table& table_;
+    std::string path_;
+    size_t snapshotEvery_;
+    size_t logRecords_;
+    size_t replayed_;
+    int fd_;
+    std::string pending_;
+    std::ostringstream record_;
+};
+
+#endif // WAL_H